@@ -0,0 +1,50 @@
+#ifndef BENCH_BENCH_HPP
+#define BENCH_BENCH_HPP
+
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <string>
+
+namespace bench
+{
+    // --quick shrinks the inputs so ctest can run every benchmark as a
+    // smoke test; the numbers are only meaningful without it.
+    inline bool IsQuick(int argc, char *argv[])
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            if (!std::strcmp(argv[i], "--quick"))
+                return true;
+        }
+        return false;
+    }
+
+    // Best time of one call to func in seconds. Repeats until minSeconds
+    // have passed, so short runs are not dominated by timer noise.
+    template<typename F>
+    double Measure(F &&func, double minSeconds = 0.25)
+    {
+        using Clock = std::chrono::steady_clock;
+
+        double best = 1e30, total = 0.0;
+        int runs = 0;
+        while (runs < 3 || total < minSeconds)
+        {
+            auto start = Clock::now();
+            func();
+            double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+            best = std::min(best, seconds);
+            total += seconds;
+            ++runs;
+        }
+        return best;
+    }
+
+    inline std::string TempPath(const std::string &name)
+    {
+        return (std::filesystem::temp_directory_path() / name).string();
+    }
+}
+
+#endif // BENCH_BENCH_HPP
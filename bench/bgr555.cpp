@@ -0,0 +1,45 @@
+#include "bench.hpp"
+#include "bgr555.hpp"
+
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// BGR555 conversion of a large batch: the vectorized span kernels against
+// converting one color at a time.
+int main(int argc, char *argv[])
+{
+    bool quick = bench::IsQuick(argc, argv);
+    size_t count = quick ? size_t(1) << 16 : size_t(1) << 24;
+    double minSeconds = quick ? 0.0 : 0.25;
+
+    std::mt19937 rng(1234);
+    std::vector<Color> colors(count), unpacked(count), reference(count);
+    std::vector<uint16_t> words(count), referenceWords(count);
+    for (auto &color : colors)
+        color = { static_cast<uint8_t>(rng()), static_cast<uint8_t>(rng()), static_cast<uint8_t>(rng()) };
+
+    double scalarPack = bench::Measure([&]() {
+        for (size_t i = 0; i < count; ++i)
+            referenceWords[i] = bgr555::Pack(colors[i]);
+    }, minSeconds);
+    double kernelPack = bench::Measure([&]() { bgr555::Pack(colors, words.data()); }, minSeconds);
+
+    double scalarUnpack = bench::Measure([&]() {
+        for (size_t i = 0; i < count; ++i)
+            reference[i] = bgr555::Unpack(referenceWords[i]);
+    }, minSeconds);
+    double kernelUnpack = bench::Measure([&]() { bgr555::Unpack(words, unpacked.data()); }, minSeconds);
+
+    if (words != referenceWords || unpacked != reference)
+    {
+        std::fputs("The kernels disagree with the scalar conversion.\n", stderr);
+        return 1;
+    }
+
+    std::printf("%zu colors\n", count);
+    std::printf("%8s %16s %16s %8s\n", "", "scalar Mcolors/s", "kernel Mcolors/s", "speedup");
+    std::printf("%8s %16.0f %16.0f %7.1fx\n", "pack", count / scalarPack / 1e6, count / kernelPack / 1e6, scalarPack / kernelPack);
+    std::printf("%8s %16.0f %16.0f %7.1fx\n", "unpack", count / scalarUnpack / 1e6, count / kernelUnpack / 1e6, scalarUnpack / kernelUnpack);
+    return 0;
+}
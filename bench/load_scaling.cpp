@@ -0,0 +1,70 @@
+#include "bench.hpp"
+#include "palette.hpp"
+#include "jobs.hpp"
+
+#include <cstdio>
+#include <random>
+#include <thread>
+#include <vector>
+
+// Loads a batch of palette files the way Combine does, one job per file
+// collected through a JobBatch, with 1, 2, 4... threads.
+int main(int argc, char *argv[])
+{
+    bool quick = bench::IsQuick(argc, argv);
+    size_t numFiles = quick ? 16 : 200;
+    size_t numColors = quick ? 256 : 16384;
+
+    std::mt19937 rng(1234);
+    std::vector<std::string> files;
+    for (size_t i = 0; i < numFiles; ++i)
+    {
+        Palette palette(numColors);
+        for (size_t j = 0; j < numColors; ++j)
+            palette[j] = { static_cast<uint8_t>(rng()), static_cast<uint8_t>(rng()), static_cast<uint8_t>(rng()) };
+
+        files.push_back(bench::TempPath("palette-bench-load-" + std::to_string(i) + ".pal"));
+        palette.SaveToFile(files.back());
+    }
+
+    unsigned maxThreads = quick ? 2 : JobSystem::GetDefaultThreadCount();
+    std::vector<unsigned> threadCounts;
+    for (unsigned threads = 1; threads < maxThreads; threads *= 2)
+        threadCounts.push_back(threads);
+    threadCounts.push_back(maxThreads);
+    std::printf("%zu files of %zu colors\n", numFiles, numColors);
+    std::printf("%8s %12s %8s\n", "threads", "files/s", "speedup");
+
+    double single = 0.0;
+    bool failed = false;
+    for (unsigned threads : threadCounts)
+    {
+        // The calling thread only waits, like the UI thread does.
+        JobSystem pool(threads);
+        double seconds = bench::Measure([&]() {
+            auto batch = JobBatch<Palette>::Run(pool, files.size(), [&files](size_t i, Palette &palette) {
+                palette.LoadFromFile(files[i]);
+            });
+
+            while (!batch->IsDone())
+                std::this_thread::yield();
+
+            for (const auto &palette : batch->GetResults())
+                failed |= palette.size() != numColors;
+        }, quick ? 0.0 : 0.5);
+
+        if (threads == 1)
+            single = seconds;
+        std::printf("%8u %12.0f %7.2fx\n", threads, numFiles / seconds, single / seconds);
+    }
+
+    for (const auto &fname : files)
+        std::filesystem::remove(fname);
+
+    if (failed)
+    {
+        std::fputs("Some files did not load.\n", stderr);
+        return 1;
+    }
+    return 0;
+}
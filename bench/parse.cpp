@@ -0,0 +1,91 @@
+#include "bench.hpp"
+#include "palette.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <utility>
+#include <vector>
+
+// Memory-mapped JASC-PAL parsing (Palette::LoadFromFile) against the
+// ifstream parser it replaced.
+namespace
+{
+    // The old loader, with the 256-color cap lifted so it can read the
+    // same inputs.
+    void StreamParse(const std::string &fname, std::vector<Color> &colors)
+    {
+        std::ifstream stream(fname);
+        std::vector<Color> new_colors;
+        std::string line;
+        size_t num_colors;
+        int r, g, b;
+
+        stream >> line;
+        if (line != "JASC-PAL")
+            throw ("Invalid JASC-PAL signature.");
+
+        stream >> line;
+        if (line != "0100")
+            throw ("Unsupported JASC-PAL version.");
+
+        if (!(stream >> num_colors))
+            throw ("Could not parse number of colors.");
+
+        for (size_t i = 0; i < num_colors; i++)
+        {
+            if (!(stream >> r >> g >> b))
+                throw ("Error parsing color components.");
+
+            if (r < 0 || g < 0 || b < 0 || r > 255 || g > 255 || b > 255)
+                throw ("Color component value must be between 0 and 255.");
+
+            new_colors.push_back({ static_cast<uint8_t>(r), static_cast<uint8_t>(g), static_cast<uint8_t>(b) });
+        }
+
+        colors = new_colors;
+    }
+
+    size_t WriteJasc(const std::string &fname, size_t numColors)
+    {
+        std::mt19937 rng(1234);
+        Palette palette(numColors);
+        for (size_t i = 0; i < numColors; ++i)
+            palette[i] = { static_cast<uint8_t>(rng()), static_cast<uint8_t>(rng()), static_cast<uint8_t>(rng()) };
+
+        palette.SaveToFile(fname);
+        return std::filesystem::file_size(fname);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    bool quick = bench::IsQuick(argc, argv);
+    std::vector<size_t> sizes = { 16, 256, quick ? size_t(16384) : size_t(1) << 20 };
+
+    std::printf("%10s %12s %12s %8s\n", "colors", "stream MB/s", "mmap MB/s", "speedup");
+    for (size_t numColors : sizes)
+    {
+        auto fname = bench::TempPath("palette-bench-" + std::to_string(numColors) + ".pal");
+        double megabytes = WriteJasc(fname, numColors) / 1e6;
+
+        std::vector<Color> streamed;
+        Palette mapped;
+        double streamSeconds = bench::Measure([&]() { StreamParse(fname, streamed); }, quick ? 0.0 : 0.25);
+        double mappedSeconds = bench::Measure([&]() { mapped.LoadFromFile(fname); }, quick ? 0.0 : 0.25);
+
+        bool same = streamed.size() == mapped.size();
+        for (size_t i = 0; same && i < streamed.size(); ++i)
+            same = streamed[i] == std::as_const(mapped)[i];
+        if (!same)
+        {
+            std::fprintf(stderr, "%zu colors: the parsers disagree.\n", numColors);
+            return 1;
+        }
+
+        std::printf("%10zu %12.1f %12.1f %7.1fx\n", numColors, megabytes / streamSeconds, megabytes / mappedSeconds, streamSeconds / mappedSeconds);
+        std::filesystem::remove(fname);
+    }
+
+    return 0;
+}
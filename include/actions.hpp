@@ -1,74 +1,186 @@
 #ifndef ACTIONS_HPP
 #define ACTIONS_HPP
 
-#include <string>
-#include <list>
-#include <memory>
-#include <concepts>
+#include <vector>
+#include <variant>
+#include <chrono>
+#include <functional>
+#include <cstdint>
+#include <type_traits>
 #include "palette.hpp"
+#include "actions/change_color_count.hpp"
+#include "actions/modify_color.hpp"
+#include "actions/swap_colors.hpp"
+#include "actions/transform_colors.hpp"
 
-class Editor;
+using ActionRecord = std::variant<Actions::ModifyColor, Actions::SwapColors, Actions::ChangeColorCount, Actions::TransformColors>;
 
-class Action
+static_assert(sizeof(ActionRecord) == 16);
+
+static_assert(std::is_trivially_copyable_v<ActionRecord>);
+
+// Everything that changes a history, in the order it happened. Replaying
+// the events on a register with the same starting state reproduces it.
+struct HistoryEvent
 {
-public:
-    Action() = default;
-    virtual ~Action() = default;
+    enum class Type : uint8_t
+    {
+        Push,
+        // The newest record was replaced by a coalesced edit.
+        Amend,
+        Undo,
+        Redo,
+        BeginTransaction,
+        CommitTransaction,
+        RollbackTransaction,
+        ClearUndo,
+    };
 
-    virtual void Revert() = 0;
-    virtual void Apply() = 0;
-    virtual std::string ToString() = 0;
-    virtual void PrintDetails() = 0;
+    Type type;
+    ActionRecord record = Actions::SwapColors(0, 0);
 };
 
+// Linear undo history of one palette. Records live by value in a ring
+// buffer; the oldest ones are dropped once the configured depth or byte
+// budget is exceeded. Colors a record cannot restore by itself (cut off by
+// shrinking the palette, or overwritten by a transform) are kept as
+// palette slices in a second buffer, in the same order as their records,
+// so no record needs a pointer or allocation of its own. The slices share
+// chunks with the palette until either side changes them.
+//
+// An undo step is one record, or all records of a transaction. Records
+// after the first of a step are flagged as joined to the one before.
 class ActionRegister
 {
 public:
-    template<std::derived_from<Action> T, typename... Args>
+    // Zero means no limit. The depth counts undo steps, not records.
+    struct Limits
+    {
+        size_t maxActions = 0;
+        size_t maxBytes = 16 << 20;
+    };
+
+    // Copy of the kept history, oldest record first.
+    struct State
+    {
+        std::vector<ActionRecord> records;
+        std::vector<uint8_t> joined;
+        size_t cursor = 0;
+        std::vector<Color> removed;
+        size_t removedCursor = 0;
+    };
+
+    using Observer = std::function<void(const HistoryEvent &)>;
+
+    static constexpr std::chrono::milliseconds DefaultCoalesceWindow{ 500 };
+
+    explicit ActionRegister(Palette &palette);
+
+    template<typename T, typename... Args>
     void RegisterAction(Args... args)
     {
-        if constexpr (std::is_abstract_v<T>)
-        {
-            []<bool flag = false>() {
-                static_assert(flag, "Action is still an abstract class.");
-            }();
-        }
-        else if constexpr (std::is_empty_v<T>)
-        {
-            m_UndoStack.push_front(std::make_shared<T>());
-        }
-        else if constexpr (requires { T(std::forward<Args>(args)...); })
-        {
-            m_UndoStack.push_front(std::make_shared<T>(std::forward<Args>(args)...));
-        }
-        else
-        {
-            []<bool flag = false>() {
-                static_assert(flag, "Action cannot be constructed from given parameters.");
-            }();
-        }
-
-        m_UndoStack.front()->Apply();
-
-        while (m_UndoStack.size() > 30)
-            m_UndoStack.pop_back();
-
-        m_RedoStack.clear();
+        static_assert(std::is_constructible_v<ActionRecord, T>, "Action is not a known record type.");
+        static_assert(std::is_constructible_v<T, Args...>, "Action cannot be constructed from given parameters.");
+
+        Push(T(args...));
     }
 
+    // Applies the action to the palette and makes it the newest undo step,
+    // or part of the open transaction.
+    void Push(const ActionRecord &record);
+
+    // Everything pushed until the matching commit becomes one undo step.
+    // Transactions nest; only the outermost commit closes the step.
+    void BeginTransaction();
+    void CommitTransaction();
+    // Reverts and drops everything pushed since the outermost begin.
+    void RollbackTransaction();
+    bool InTransaction() const { return m_TransactionDepth > 0; }
+
+    // A ModifyColor of the same slot as the newest step is folded into it
+    // when it comes within the window, or at any time inside a transaction.
+    void SetCoalesceWindow(std::chrono::milliseconds window) { m_CoalesceWindow = window; }
+
     void Undo();
     void Redo();
 
+    // Called after every change, e.g. to write a journal.
+    void SetObserver(Observer observer) { m_Observer = std::move(observer); }
+    // Repeats an event exactly, without coalescing or notifying.
+    void Replay(const HistoryEvent &event);
+
+    State GetState() const;
+    // Replaces the history; the palette must already match its cursor.
+    void SetState(State &&state);
+
     void ClearUndoStack();
     void ClearRedoStack();
 
-    bool CanUndo() { return !m_UndoStack.empty(); }
-    bool CanRedo() { return !m_RedoStack.empty(); }
+    bool CanUndo() const { return m_StepCursor > 0 && !InTransaction(); }
+    bool CanRedo() const { return m_StepCursor < m_Steps && !InTransaction(); }
+
+    size_t GetUndoCount() const { return m_StepCursor; }
+    size_t GetRedoCount() const { return m_Steps - m_StepCursor; }
+
+    // Records [0, GetRecordCursor()) are undo records, oldest first, the
+    // rest up to GetRecordCount() can be redone.
+    size_t GetRecordCount() const { return m_Count; }
+    size_t GetRecordCursor() const { return m_Cursor; }
+    const ActionRecord &GetRecord(size_t i) const { return m_Records[Slot(i)]; }
+    bool IsJoined(size_t i) const { return m_Joined[Slot(i)]; }
 
-    const auto &GetRedoStack() const { return m_RedoStack; }
-    const auto &GetUndoStack() const { return m_UndoStack; }
+    size_t GetMemoryUsage() const;
+
+    // Same value as Palette::Hash(), kept up to date with every applied or
+    // reverted record instead of being recomputed.
+    uint64_t GetHash() const { return m_Hash; }
+    // Needed after the palette was changed without a record, e.g. replaced
+    // by a freshly loaded one.
+    void Rehash() { m_Hash = m_Palette.Hash(); }
+
+    const Limits &GetLimits() const { return m_Limits; }
+    void SetLimits(const Limits &limits);
+
+    // Used by registers created afterwards.
+    static const Limits &GetDefaultLimits() { return s_DefaultLimits; }
+    static void SetDefaultLimits(const Limits &limits) { s_DefaultLimits = limits; }
 private:
-    std::list<std::shared_ptr<Action>> m_RedoStack, m_UndoStack;
+    size_t Slot(size_t i) const { return (m_Head + i) % m_Records.size(); }
+
+    void Notify(HistoryEvent::Type type, const ActionRecord &record = Actions::SwapColors(0, 0));
+    void PushRecord(const ActionRecord &record);
+    void ApplyRecord(const ActionRecord &record);
+    bool CanCoalesce(const Actions::ModifyColor &edit) const;
+    void Amend(const Actions::ModifyColor &edit);
+    void RevertTop();
+    void Reserve(size_t capacity);
+    void EvictOldestStep();
+    void EnforceLimits();
+
+    Palette &m_Palette;
+    Limits m_Limits;
+    uint64_t m_Hash = 0;
+
+    std::vector<ActionRecord> m_Records;
+    std::vector<uint8_t> m_Joined;
+    size_t m_Head = 0, m_Count = 0, m_Cursor = 0;
+    size_t m_Steps = 0, m_StepCursor = 0;
+
+    // Live slices are [m_RemovedBegin, size()), those of undo records end
+    // at m_RemovedCursor. m_RemovedColors counts the colors of live ones.
+    std::vector<Palette> m_Removed;
+    size_t m_RemovedBegin = 0, m_RemovedCursor = 0;
+    size_t m_RemovedColors = 0;
+
+    size_t m_TransactionDepth = 0, m_TransactionSize = 0;
+
+    bool m_CanCoalesce = false;
+    std::chrono::milliseconds m_CoalesceWindow = DefaultCoalesceWindow;
+    std::chrono::steady_clock::time_point m_LastPush;
+
+    Observer m_Observer;
+
+    static Limits s_DefaultLimits;
 };
 
-#endif // ACTIONS_HPP
\ No newline at end of file
+#endif // ACTIONS_HPP
@@ -1,24 +1,32 @@
 #ifndef ACTIONS_CHANGE_COLOR_COUNT_HPP
 #define ACTIONS_CHANGE_COLOR_COUNT_HPP
 
-#include <palette.hpp>
-#include "actions.hpp"
-#include <vector>
+#include "palette.hpp"
 
 namespace Actions
 {
-    class ChangeColorCount : public Action
+    // The colors cut off by shrinking are not part of the record, the
+    // register keeps them as a slice of the palette and hands them to
+    // Revert.
+    struct ChangeColorCount
     {
-    public:
-        ChangeColorCount(size_t _old, size_t _new);
-        virtual void Apply() override;
-        virtual void Revert() override;
-        virtual std::string ToString() { return "ChangeColorCount"; }
-        virtual void PrintDetails() override;
-    private:
-        size_t m_OldSize, m_NewSize;
-        std::vector<Color> m_Colors;
+        static constexpr const char *Name = "ChangeColorCount";
+
+        ChangeColorCount(size_t _old, size_t _new) : oldSize(static_cast<uint32_t>(_old)), newSize(static_cast<uint32_t>(_new)) { }
+
+        size_t RemovedCount() const { return oldSize > newSize ? oldSize - newSize : 0; }
+        Palette Capture(const Palette &palette) const { return palette.Slice(newSize, RemovedCount()); }
+
+        void Apply(Palette &palette) const { palette.resize(newSize); }
+        void Revert(Palette &palette, const Palette &removed) const
+        {
+            palette.resize(newSize);
+            palette += removed;
+            palette.resize(oldSize);
+        }
+
+        uint32_t oldSize, newSize;
     };
 }
 
-#endif // ACTIONS_CHANGE_COLOR_COUNT_HPP
\ No newline at end of file
+#endif // ACTIONS_CHANGE_COLOR_COUNT_HPP
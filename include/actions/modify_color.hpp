@@ -1,24 +1,23 @@
 #ifndef ACTIONS_MODIFY_COLOR_HPP
 #define ACTIONS_MODIFY_COLOR_HPP
 
-#include "actions.hpp"
 #include "palette.hpp"
 
 namespace Actions
 {
-    class ModifyColor final : public Action
+    struct ModifyColor
     {
-    public:
+        static constexpr const char *Name = "ModifyColor";
+
         ModifyColor(size_t idx, const Color &old_color, const Color &new_color) :
-            m_Index(idx), m_OldColor(old_color), m_NewColor(new_color) {}
-        virtual void Apply() override;
-        virtual void Revert() override;
-        virtual std::string ToString() { return "ModifyColor"; }
-        virtual void PrintDetails() override;
-    private:
-        size_t m_Index;
-        Color m_OldColor, m_NewColor;
+            index(static_cast<uint32_t>(idx)), oldColor(old_color), newColor(new_color) { }
+
+        void Apply(Palette &palette) const { palette[index] = newColor; }
+        void Revert(Palette &palette) const { palette[index] = oldColor; }
+
+        uint32_t index;
+        Color oldColor, newColor;
     };
 }
 
-#endif // ACTIONS_MODIFY_COLOR_HPP
\ No newline at end of file
+#endif // ACTIONS_MODIFY_COLOR_HPP
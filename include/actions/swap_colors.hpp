@@ -1,21 +1,22 @@
 #ifndef ACTIONS_SWAP_COLORS_HPP
 #define ACTIONS_SWAP_COLORS_HPP
 
-#include "actions.hpp"
+#include "palette.hpp"
+#include <utility>
 
 namespace Actions
 {
-    class SwapColors final : public Action
+    struct SwapColors
     {
-    public:
-        SwapColors(size_t start, size_t end) : m_Start(start), m_End(end) { }
-        virtual void Apply() override;
-        virtual void Revert() override;
-        virtual std::string ToString() { return "SwapColors"; }
-        virtual void PrintDetails() override;
-    private:
-        size_t m_Start, m_End;
+        static constexpr const char *Name = "SwapColors";
+
+        SwapColors(size_t start, size_t end) : first(static_cast<uint32_t>(start)), second(static_cast<uint32_t>(end)) { }
+
+        void Apply(Palette &palette) const { std::swap(palette[first], palette[second]); }
+        void Revert(Palette &palette) const { Apply(palette); }
+
+        uint32_t first, second;
     };
 }
 
-#endif // ACTIONS_SWAP_COLORS_HPP
\ No newline at end of file
+#endif // ACTIONS_SWAP_COLORS_HPP
@@ -0,0 +1,30 @@
+#ifndef ACTIONS_TRANSFORM_COLORS_HPP
+#define ACTIONS_TRANSFORM_COLORS_HPP
+
+#include "palette.hpp"
+#include "transform.hpp"
+
+namespace Actions
+{
+    // Only the range and the transform are recorded. Transforms lose
+    // information, so the register keeps the colors from before as a slice
+    // of the palette and hands them to Revert.
+    struct TransformColors
+    {
+        static constexpr const char *Name = "TransformColors";
+
+        TransformColors(size_t _begin, size_t _count, const Transform &_transform) :
+            begin(static_cast<uint32_t>(_begin)), count(static_cast<uint32_t>(_count)), transform(_transform) { }
+
+        size_t RemovedCount() const { return count; }
+        Palette Capture(const Palette &palette) const { return palette.Slice(begin, count); }
+
+        void Apply(Palette &palette) const { transform.Apply(palette, begin, count); }
+        void Revert(Palette &palette, const Palette &removed) const { palette.Paste(begin, removed); }
+
+        uint32_t begin, count;
+        Transform transform;
+    };
+}
+
+#endif // ACTIONS_TRANSFORM_COLORS_HPP
@@ -0,0 +1,30 @@
+#ifndef BGR555_HPP
+#define BGR555_HPP
+
+#include <span>
+#include <cstdint>
+#include "palette.hpp"
+
+// 15-bit little-endian BGR colors as used by GBA hardware palettes.
+namespace bgr555
+{
+    constexpr uint16_t Pack(const Color &color)
+    {
+        return (color.r >> 3) | ((color.g >> 3) << 5) | ((color.b >> 3) << 10);
+    }
+
+    constexpr Color Unpack(uint16_t value)
+    {
+        auto expand = [](unsigned c) -> uint8_t { return static_cast<uint8_t>((c << 3) | (c >> 2)); };
+        return { expand(value & 0x1F), expand((value >> 5) & 0x1F), expand((value >> 10) & 0x1F) };
+    }
+
+    // Rounds a color to the nearest value the hardware can display.
+    constexpr Color Snap(const Color &color) { return Unpack(Pack(color)); }
+
+    void Pack(std::span<const Color> in, uint16_t *out);
+    void Unpack(std::span<const uint16_t> in, Color *out);
+    void Snap(std::span<Color> colors);
+}
+
+#endif // BGR555_HPP
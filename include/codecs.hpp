@@ -0,0 +1,53 @@
+#ifndef CODECS_HPP
+#define CODECS_HPP
+
+#include <string>
+#include <span>
+#include <vector>
+#include "palette.hpp"
+
+class Codec
+{
+public:
+    enum class Match
+    {
+        None,
+        Weak,   // Plausible, e.g. only the file size fits.
+        Strong, // Magic bytes matched.
+    };
+
+    Codec() = default;
+    virtual ~Codec() = default;
+
+    virtual const char *GetName() const = 0;
+    virtual const char *GetDescription() const = 0;
+    // Comma separated, without dots. Empty if the codec is only used explicitly.
+    virtual const char *GetExtensions() const = 0;
+
+    // Only ever sees the first Codecs::SniffSize bytes of the file.
+    virtual Match Sniff(std::span<const char> header, size_t fileSize) const = 0;
+    // A weak match is only trusted when the file has one of its extensions.
+    virtual bool NeedsExtension() const { return false; }
+    virtual void Decode(Palette &palette, std::span<const char> buffer) const = 0;
+    virtual void Encode(const Palette &palette, std::string &buffer) const = 0;
+
+    bool HasExtension(const std::string &fname) const;
+};
+
+namespace Codecs
+{
+    constexpr size_t SniffSize = 64;
+
+    const std::vector<const Codec *> &GetAll();
+    const Codec *FindByName(const std::string &name);
+    const Codec *FindByExtension(const std::string &fname);
+
+    // Picks the best match from the header, using the file name to break ties.
+    // Falls back to the codec owning the extension, so that its decoder can
+    // report what is wrong with the file.
+    const Codec *Detect(std::span<const char> header, size_t fileSize, const std::string &fname = "");
+    // Only reads the header of the file.
+    const Codec *DetectFile(const std::string &fname);
+}
+
+#endif // CODECS_HPP
@@ -0,0 +1,20 @@
+#ifndef CODECS_ACT_HPP
+#define CODECS_ACT_HPP
+
+#include "codecs.hpp"
+
+namespace Codecs
+{
+    class Act final : public Codec
+    {
+    public:
+        virtual const char *GetName() const override { return "act"; }
+        virtual const char *GetDescription() const override { return "Adobe Color Table"; }
+        virtual const char *GetExtensions() const override { return "act"; }
+        virtual Match Sniff(std::span<const char> header, size_t fileSize) const override;
+        virtual void Decode(Palette &palette, std::span<const char> buffer) const override;
+        virtual void Encode(const Palette &palette, std::string &buffer) const override;
+    };
+}
+
+#endif // CODECS_ACT_HPP
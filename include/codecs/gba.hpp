@@ -0,0 +1,21 @@
+#ifndef CODECS_GBA_HPP
+#define CODECS_GBA_HPP
+
+#include "codecs.hpp"
+
+namespace Codecs
+{
+    class Bgr555 final : public Codec
+    {
+    public:
+        virtual const char *GetName() const override { return "gbapal"; }
+        virtual const char *GetDescription() const override { return "GBA BGR555"; }
+        virtual const char *GetExtensions() const override { return "gbapal"; }
+        virtual Match Sniff(std::span<const char> header, size_t fileSize) const override;
+        virtual bool NeedsExtension() const override { return true; }
+        virtual void Decode(Palette &palette, std::span<const char> buffer) const override;
+        virtual void Encode(const Palette &palette, std::string &buffer) const override;
+    };
+}
+
+#endif // CODECS_GBA_HPP
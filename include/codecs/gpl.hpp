@@ -0,0 +1,20 @@
+#ifndef CODECS_GPL_HPP
+#define CODECS_GPL_HPP
+
+#include "codecs.hpp"
+
+namespace Codecs
+{
+    class Gpl final : public Codec
+    {
+    public:
+        virtual const char *GetName() const override { return "gpl"; }
+        virtual const char *GetDescription() const override { return "GIMP Palette"; }
+        virtual const char *GetExtensions() const override { return "gpl"; }
+        virtual Match Sniff(std::span<const char> header, size_t fileSize) const override;
+        virtual void Decode(Palette &palette, std::span<const char> buffer) const override;
+        virtual void Encode(const Palette &palette, std::string &buffer) const override;
+    };
+}
+
+#endif // CODECS_GPL_HPP
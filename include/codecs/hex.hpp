@@ -0,0 +1,20 @@
+#ifndef CODECS_HEX_HPP
+#define CODECS_HEX_HPP
+
+#include "codecs.hpp"
+
+namespace Codecs
+{
+    class HexList final : public Codec
+    {
+    public:
+        virtual const char *GetName() const override { return "hex"; }
+        virtual const char *GetDescription() const override { return "Hex List"; }
+        virtual const char *GetExtensions() const override { return "hex,txt"; }
+        virtual Match Sniff(std::span<const char> header, size_t fileSize) const override;
+        virtual void Decode(Palette &palette, std::span<const char> buffer) const override;
+        virtual void Encode(const Palette &palette, std::string &buffer) const override;
+    };
+}
+
+#endif // CODECS_HEX_HPP
@@ -0,0 +1,23 @@
+#ifndef CODECS_JASC_HPP
+#define CODECS_JASC_HPP
+
+#include "codecs.hpp"
+
+namespace Codecs
+{
+    class Jasc final : public Codec
+    {
+    public:
+        Jasc(bool strict = false) : m_Strict(strict) { }
+        virtual const char *GetName() const override { return m_Strict ? "jasc-strict" : "jasc"; }
+        virtual const char *GetDescription() const override { return m_Strict ? "JASC-PAL (strict)" : "JASC-PAL"; }
+        virtual const char *GetExtensions() const override { return m_Strict ? "" : "pal"; }
+        virtual Match Sniff(std::span<const char> header, size_t fileSize) const override;
+        virtual void Decode(Palette &palette, std::span<const char> buffer) const override;
+        virtual void Encode(const Palette &palette, std::string &buffer) const override;
+    private:
+        bool m_Strict;
+    };
+}
+
+#endif // CODECS_JASC_HPP
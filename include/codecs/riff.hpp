@@ -0,0 +1,20 @@
+#ifndef CODECS_RIFF_HPP
+#define CODECS_RIFF_HPP
+
+#include "codecs.hpp"
+
+namespace Codecs
+{
+    class RiffPal final : public Codec
+    {
+    public:
+        virtual const char *GetName() const override { return "riff"; }
+        virtual const char *GetDescription() const override { return "RIFF PAL"; }
+        virtual const char *GetExtensions() const override { return "pal"; }
+        virtual Match Sniff(std::span<const char> header, size_t fileSize) const override;
+        virtual void Decode(Palette &palette, std::span<const char> buffer) const override;
+        virtual void Encode(const Palette &palette, std::string &buffer) const override;
+    };
+}
+
+#endif // CODECS_RIFF_HPP
@@ -4,29 +4,125 @@
 #include "palette.hpp"
 #include "actions.hpp"
 #include "popups.hpp"
+#include "jobs.hpp"
+#include "journal.hpp"
+#include "macro.hpp"
+#include <optional>
+#include <cstdio>
+
+class Codec;
 
 struct Context
 {
+    struct MemoryUsage
+    {
+        size_t palette = 0;
+        size_t history = 0;
+        // History of a compacted tab, kept in a temporary file.
+        size_t spilled = 0;
+
+        size_t Total() const { return palette + history; }
+    };
+
     Palette palette;
     ActionRegister actionRegister;
-    bool isDirty = false;
+    Journal journal;
     std::string loadedFile;
+    // Format loadedFile was decoded from. Saving writes it again, so a file
+    // whose extension several codecs share keeps its format; null means
+    // the extension decides.
+    const Codec *codec = nullptr;
+    // Hash of the colors in loadedFile; empty until the tab was saved once.
+    std::optional<uint64_t> savedHash;
+    // Receives the history of this tab while a macro is being recorded.
+    std::shared_ptr<Macro> recordingMacro;
+
+    Context();
+    ~Context();
+
+    bool IsLoading() const { return m_Loading != nullptr; }
+    // Compares the rolling hash of the register, so undoing back to the
+    // saved colors makes the tab clean again.
+    bool IsDirty() const { return !savedHash || *savedHash != (m_IsCompacted ? m_CompactedHash : actionRegister.GetHash()); }
+
+    MemoryUsage GetMemoryUsage() const;
+    // A compacted tab keeps its palette compressed in memory and its undo
+    // history in a temporary file; palette and actionRegister are empty
+    // until Expand is called.
+    bool IsCompacted() const { return m_IsCompacted; }
+    bool Compact();
+    void Expand();
+
+    // Replaces the colors without a history record.
+    void SetPalette(const Palette &colors);
+    // Called after the palette was written to loadedFile.
+    void MarkSaved();
 
-    Context() : palette(1) { }
-    Context(const std::string &fname);
+    // When enabled, every tab with a file keeps its undo history in a
+    // journal next to the file and gets it back when the file is reopened.
+    static bool IsJournalEnabled() { return s_JournalEnabled; }
+    static void SetJournalEnabled(bool enabled);
 
     static auto &GetContext() { return *s_CurrentContext; }
-    static void SetContext(size_t idx) { s_CurrentContext = s_OpenContexts[idx].get(); }
+    static void SetContext(size_t idx);
 
     static const bool HasNoContext() { return s_OpenContexts.empty() || s_CurrentContext == nullptr; }
+    static const bool HasEditableContext() { return !HasNoContext() && !s_CurrentContext->IsLoading(); }
 
     static Context &CreateNewContext();
-    static Context &CreateNewContext(const std::string &fname);
+    // New untitled tab with the colors of source; both share the storage
+    // until one of them is edited.
+    static Context &DuplicateContext(const Context &source);
+    // Opens a placeholder tab right away and parses the file on the job
+    // system. UpdateLoadingContexts fills it in once parsing is done.
+    static Context &OpenContext(const std::string &fname);
+    // Returns one message per file that failed to load; their tabs are closed.
+    static std::vector<std::string> UpdateLoadingContexts();
     static auto &GetOpenContexts() { return s_OpenContexts; } 
     static void RemoveContext(size_t i);
+    // Looks the tab up first, it may have moved or be gone already.
+    static void RemoveContext(const Context *ctx);
+
+    // All open tabs with their colors, paths and dirty state in one binary
+    // file, plus their undo history when that is enabled. Restoring does
+    // not read the palette files themselves; tabs that were still loading
+    // are opened again.
+    static bool SaveSession(const std::string &fname);
+    static bool RestoreSession(const std::string &fname);
+    static bool IsSessionHistoryEnabled() { return s_SessionHistory; }
+    static void SetSessionHistoryEnabled(bool enabled) { s_SessionHistory = enabled; }
+
+    static MemoryUsage GetTotalMemoryUsage();
+    // Bytes all tabs together may use before the least recently used ones
+    // are compacted; 0 means no limit.
+    static size_t GetMemoryBudget() { return s_MemoryBudget; }
+    static void SetMemoryBudget(size_t bytes);
+    static void EnforceMemoryBudget();
 private:
+    struct LoadResult
+    {
+        Palette palette;
+        const Codec *codec = nullptr;
+        std::string error;
+    };
+
+    std::shared_ptr<JobBatch<LoadResult>> m_Loading;
+
+    bool m_IsCompacted = false;
+    std::string m_CompressedPalette;
+    std::FILE *m_SpilledHistory = nullptr;
+    size_t m_SpilledSize = 0;
+    uint64_t m_CompactedHash = 0;
+    uint64_t m_LastUsed = 0;
+
+    bool ReadSpilledHistory(std::string &out) const;
+
     static std::vector<std::unique_ptr<Context>> s_OpenContexts; 
     static Context *s_CurrentContext;
+    static bool s_JournalEnabled;
+    static bool s_SessionHistory;
+    static size_t s_MemoryBudget;
+    static uint64_t s_UseCounter;
 };
 
-#endif // CONTEXT_HPP
\ No newline at end of file
+#endif // CONTEXT_HPP
\ No newline at end of file
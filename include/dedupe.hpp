@@ -0,0 +1,44 @@
+#ifndef DEDUPE_HPP
+#define DEDUPE_HPP
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include "palette.hpp"
+#include "jobs.hpp"
+
+// Groups palettes by their color content. Entries remember the size and
+// modification time of their file, so refreshing only rehashes files that
+// changed since the last run.
+class DedupeIndex
+{
+public:
+    struct Entry
+    {
+        uint64_t hash = 0;
+        uint64_t fileSize = 0;
+        int64_t modifiedTime = 0;
+        size_t numColors = 0;
+        bool valid = false;
+    };
+
+    bool Load(const std::string &fname);
+    bool Save(const std::string &fname) const;
+
+    // Returns the number of files that had to be hashed.
+    size_t Refresh(const std::vector<std::string> &files, JobSystem &pool = JobSystem::Get());
+    // Drops entries whose files no longer exist.
+    void Prune();
+
+    // For palettes that are not (or not only) on disk, e.g. open tabs.
+    void Update(const std::string &key, const Palette &palette);
+    void Remove(const std::string &key);
+
+    const auto &GetEntries() const { return m_Entries; }
+    std::vector<std::vector<std::string>> GetDuplicateGroups() const;
+private:
+    std::unordered_map<std::string, Entry> m_Entries;
+};
+
+#endif // DEDUPE_HPP
@@ -3,17 +3,41 @@
 
 #include "palette.hpp"
 #include "popups.hpp"
+#include "macro.hpp"
+#include "swatch_view.hpp"
+#include <memory>
+#include <cstdint>
+#include <vector>
 
 struct GLFWwindow;
 
 class Editor
 {
 public:
+    // In seconds. Frame time covers input handling up to the buffer swap,
+    // frame interval is the time between back-to-back frames and input
+    // latency runs from the key press to the swap that showed its result.
+    struct FrameStats
+    {
+        double frameTime = 0.0;
+        double frameInterval = 0.0;
+        double inputLatency = 0.0;
+        double maxInputLatency = 0.0;
+    };
+
     Editor();
     ~Editor();
 
     void Loop(void);
+    const FrameStats &GetFrameStats(void) const { return m_FrameStats; }
 private:
+    struct KeyEvent
+    {
+        int key, mods;
+        bool repeat;
+        double time;
+    };
+
     void InitGLFW(void);
     void InitImGui(void);
 
@@ -27,16 +51,42 @@ private:
     void MenuBar(void);
     void DetailsBar(void);
     void PaletteEditor(void);
+    void PaletteGrid(void);
     void StatusBar(void);
+    void HistoryLimits(void);
+    void MemoryBudget(void);
+    void TraceMenu(void);
 
     void OpenPalette(const char *);
     void PromptOpenPalette(void);
     void SavePalette(bool);
+    void SaveAllPalettes(void);
+    void ExportStrictPalette(void);
+    void SnapPaletteTo15Bit(void);
+    bool IsRecordingMacro(void) const;
 
+    void QueueKey(int key, int mods, bool repeat);
+    // Returns when the oldest handled key was pressed, or a negative value
+    // when there was none.
+    double ProcessInput(void);
     void ProcessShortcuts(int key, int mods);
+    void UpdateFrameStats(double frameStart, double inputTime, bool continuous);
 
     PopupManager m_PopupManager;
     GLFWwindow *m_Window;
+    bool m_Snap15Bit = false;
+    bool m_SelectCurrentTab = false;
+    bool m_LazyRedraw = true;
+    bool m_GridLayout = false;
+    // Starts above zero so the window paints before waiting for input.
+    int m_PendingFrames = 1;
+    // Every rendered frame; stays put while the editor is idle.
+    uint64_t m_FrameCount = 0;
+    std::vector<KeyEvent> m_KeyQueue;
+    FrameStats m_FrameStats;
+    SwatchView m_SwatchView;
+    double m_LastFrameEnd = 0.0;
+    std::shared_ptr<Macro> m_Macro = std::make_shared<Macro>();
 };
 
-#endif // EDITOR_HPP
\ No newline at end of file
+#endif // EDITOR_HPP
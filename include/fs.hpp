@@ -8,9 +8,19 @@ namespace fs
 {
     using PromptCallback = std::function<void(const char *)>;
 
+    // Picks the filters shown in the dialogs.
+    enum class FileType
+    {
+        Palette,
+        Macro,
+        Text,
+        Trace,
+    };
+
     std::string GetFilename(const std::string &path);
-    bool OpenFilePrompt(PromptCallback cb, const char *defaultPath = nullptr);
-    bool SaveFilePrompt(PromptCallback cb);
+    bool Exists(const std::string &path);
+    bool OpenFilePrompt(PromptCallback cb, const char *defaultPath = nullptr, FileType type = FileType::Palette);
+    bool SaveFilePrompt(PromptCallback cb, FileType type = FileType::Palette);
 }
 
-#endif // FS_HPP
\ No newline at end of file
+#endif // FS_HPP
\ No newline at end of file
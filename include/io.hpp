@@ -0,0 +1,45 @@
+#ifndef IO_HPP
+#define IO_HPP
+
+#include <string>
+#include <span>
+#include <cstddef>
+
+namespace io
+{
+    // Read-only view of a whole file. Uses mmap/MapViewOfFile where available.
+    class MappedFile
+    {
+    public:
+        MappedFile() = default;
+        MappedFile(const std::string &fname);
+        ~MappedFile();
+
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+        MappedFile(MappedFile &&other) noexcept;
+        MappedFile &operator=(MappedFile &&other) noexcept;
+
+        bool Open(const std::string &fname);
+        void Close();
+
+        constexpr bool IsOpen() const { return m_IsOpen; }
+        constexpr const char *data() const { return m_Data; }
+        constexpr size_t size() const { return m_Size; }
+        constexpr std::span<const char> GetSpan() const { return { m_Data, m_Size }; }
+    private:
+        const char *m_Data = nullptr;
+        size_t m_Size = 0;
+        bool m_IsOpen = false;
+#if defined(_WIN32)
+        void *m_File = nullptr;
+        void *m_Mapping = nullptr;
+#endif
+    };
+
+    // Writes the data to a temporary file next to fname and renames it over
+    // fname, so readers never observe a partially written file.
+    bool WriteFileAtomic(const std::string &fname, std::span<const char> data);
+}
+
+#endif // IO_HPP
@@ -0,0 +1,98 @@
+#ifndef JOBS_HPP
+#define JOBS_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Small work-stealing thread pool. Every worker owns a queue and runs its
+// newest job first; a worker that runs dry steals the oldest job from
+// another queue, so a batch spreads out without one shared hot lock.
+class JobSystem
+{
+public:
+    using Job = std::function<void()>;
+
+    // With no worker threads, Submit runs the job on the calling thread
+    // before it returns.
+    explicit JobSystem(unsigned numThreads);
+    ~JobSystem();
+    JobSystem(const JobSystem &) = delete;
+    JobSystem &operator=(const JobSystem &) = delete;
+
+    // Shared pool with one worker per core, minus the calling thread.
+    static JobSystem &Get();
+    static unsigned GetDefaultThreadCount();
+
+    unsigned GetThreadCount() const { return static_cast<unsigned>(m_Workers.size()); }
+
+    void Submit(Job job);
+
+    // Runs body(i) for every i in [0, count) and returns once all calls
+    // have finished. The calling thread takes part, but only in this batch.
+    void ParallelFor(size_t count, const std::function<void(size_t)> &body);
+private:
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<Job> jobs;
+    };
+
+    bool TryPop(size_t self, Job &job);
+    void WorkerLoop(size_t idx);
+
+    std::vector<std::unique_ptr<Queue>> m_Queues;
+    std::vector<std::thread> m_Workers;
+    std::atomic<size_t> m_Pending = 0;
+    std::atomic<size_t> m_NextQueue = 0;
+    std::mutex m_SleepMutex;
+    std::condition_variable m_WakeUp;
+    bool m_Quit = false;
+};
+
+// Results of jobs submitted together. Each job fills its own slot, so the
+// results keep the submission order no matter which job finishes first.
+// The UI polls IsDone() instead of blocking on the batch.
+template<typename T>
+class JobBatch
+{
+public:
+    explicit JobBatch(size_t count) : m_Results(count), m_Remaining(count) { }
+
+    // func(i, result) runs on a worker for every i in [0, count). onDone
+    // runs once after the last job, when IsDone() already returns true.
+    template<typename F>
+    static std::shared_ptr<JobBatch> Run(JobSystem &pool, size_t count, F func, std::function<void()> onDone = {})
+    {
+        auto batch = std::make_shared<JobBatch>(count);
+        if (count == 0 && onDone)
+            onDone();
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            pool.Submit([batch, func, onDone, i]() {
+                func(i, batch->m_Results[i]);
+                if (batch->m_Remaining.fetch_sub(1, std::memory_order_acq_rel) == 1 && onDone)
+                    onDone();
+            });
+        }
+        return batch;
+    }
+
+    bool IsDone() const { return GetRemaining() == 0; }
+    size_t GetRemaining() const { return m_Remaining.load(std::memory_order_acquire); }
+    size_t size() const { return m_Results.size(); }
+
+    // Only safe to touch once IsDone() returned true.
+    std::vector<T> &GetResults() { return m_Results; }
+private:
+    std::vector<T> m_Results;
+    std::atomic<size_t> m_Remaining;
+};
+
+#endif // JOBS_HPP
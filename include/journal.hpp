@@ -0,0 +1,63 @@
+#ifndef JOURNAL_HPP
+#define JOURNAL_HPP
+
+#include <string>
+#include <span>
+#include <cstdio>
+#include <cstdint>
+#include "palette.hpp"
+#include "actions.hpp"
+
+// Append-only record of one palette's undo history, kept next to the
+// palette as <file>.journal. The file starts with a checkpoint holding the
+// palette and its whole history, followed by one 16-byte entry per history
+// event. Reopening maps the file, loads the checkpoint as is and replays
+// only the entries after it; every CheckpointInterval entries the file is
+// rewritten as a fresh checkpoint, so that tail stays short.
+class Journal
+{
+public:
+    static constexpr size_t CheckpointInterval = 4096;
+
+    Journal(const Palette &palette, const ActionRegister &actions) : m_Palette(palette), m_Actions(actions) { }
+    ~Journal();
+
+    Journal(const Journal &) = delete;
+    Journal &operator=(const Journal &) = delete;
+
+    static std::string GetPath(const std::string &paletteFile) { return paletteFile + ".journal"; }
+
+    // Loads the journal of paletteFile into palette and actions. It is only
+    // used if it was last saved with the colors the file has now
+    // (fileHash); otherwise the file was changed elsewhere and nothing is
+    // touched.
+    static bool Restore(const std::string &paletteFile, uint64_t fileHash, Palette &palette, ActionRegister &actions);
+
+    // The history part of a checkpoint on its own, for keeping a history
+    // out of memory while its tab is not used.
+    static void SaveHistory(std::string &out, const ActionRegister::State &state);
+    static bool LoadHistory(std::span<const char> data, ActionRegister::State &state);
+
+    // Starts a new journal for paletteFile with a checkpoint of the current
+    // state; savedHash is the hash of the colors on disk.
+    bool Open(const std::string &paletteFile, uint64_t savedHash);
+    void Close();
+    bool IsOpen() const { return m_File != nullptr; }
+    const std::string &GetPaletteFile() const { return m_PaletteFile; }
+
+    void Append(const HistoryEvent &event);
+    void MarkSaved(uint64_t hash);
+    bool Checkpoint();
+private:
+    void WriteEntry(const char *entry);
+
+    const Palette &m_Palette;
+    const ActionRegister &m_Actions;
+
+    std::string m_PaletteFile;
+    std::FILE *m_File = nullptr;
+    size_t m_NumEntries = 0;
+    uint64_t m_SavedHash = 0;
+};
+
+#endif // JOURNAL_HPP
@@ -0,0 +1,46 @@
+#ifndef MACRO_HPP
+#define MACRO_HPP
+
+#include <string>
+#include <vector>
+#include "palette.hpp"
+#include "actions.hpp"
+
+// A recorded sequence of actions that can be applied to other palettes.
+// Applying is absolute: a ModifyColor sets its slot to the new color and
+// a ChangeColorCount sets the size, whatever the target had before.
+// Actions that reach past the end of a target are skipped; transforms are
+// cut to the colors the target has.
+class Macro
+{
+public:
+    static constexpr const char *Extension = "macro";
+
+    // Builds the macro from the history events of the palette being
+    // recorded. Steps undone while recording are left out.
+    void Observe(const HistoryEvent &event);
+
+    void Clear();
+    bool empty() const { return m_Actions.empty(); }
+    size_t size() const { return m_Actions.size(); }
+    const std::vector<ActionRecord> &GetActions() const { return m_Actions; }
+
+    // Both return the number of actions that were skipped. Through a
+    // register the whole macro becomes one undo step.
+    size_t ApplyTo(Palette &palette) const;
+    size_t ApplyTo(Palette &palette, ActionRegister &actions) const;
+    // Loads, applies and writes back one file in its own format. Returns
+    // an error message, empty on success.
+    std::string ApplyToFile(const std::string &fname) const;
+
+    bool Load(const std::string &fname);
+    bool Save(const std::string &fname) const;
+private:
+    std::vector<ActionRecord> m_Actions;
+    std::vector<size_t> m_StepBegin;
+    std::vector<std::vector<ActionRecord>> m_UndoneSteps;
+    size_t m_TransactionDepth = 0;
+    bool m_TransactionHasStep = false;
+};
+
+#endif // MACRO_HPP
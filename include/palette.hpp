@@ -3,41 +3,140 @@
 
 #include <vector>
 #include <array>
-#include <fstream>
+#include <string>
+#include <span>
+#include <cstdint>
+#include <memory>
+#include <atomic>
+#include <algorithm>
 
+// Colors are stored as packed 8-bit RGB, the same precision palette files
+// use. The fourth byte is padding so a color fits in one 32-bit word.
 struct Color
 {
-    float r, g, b;
-    
-    constexpr auto &operator[](size_t idx) { return ((float *)(void *)this)[idx]; }
-    constexpr const auto &operator[](size_t idx) const { return ((float *)(void *)this)[idx]; }
+    uint8_t r, g, b, unused = 0;
 
-    bool operator==(const Color &other) { return this->r == other.r && this->g == other.g && this->b == other.b; }
-    bool operator!=(const Color &other) { return !(*this == other); }
+    constexpr uint8_t &operator[](size_t idx) { return idx == 0 ? r : (idx == 1 ? g : b); }
+    constexpr const uint8_t &operator[](size_t idx) const { return idx == 0 ? r : (idx == 1 ? g : b); }
+
+    constexpr bool operator==(const Color &other) const { return r == other.r && g == other.g && b == other.b; }
+    constexpr bool operator!=(const Color &other) const { return !(*this == other); }
+
+    constexpr std::array<float, 3> ToFloat() const { return { r / 255.0f, g / 255.0f, b / 255.0f }; }
+
+    static constexpr Color FromFloat(const float *components)
+    {
+        auto quantize = [](float v) -> uint8_t {
+            v = v < 0.0f ? 0.0f : (v > 1.0f ? 1.0f : v);
+            return static_cast<uint8_t>(v * 255.0f + 0.5f);
+        };
+        return { quantize(components[0]), quantize(components[1]), quantize(components[2]) };
+    }
 };
 
+static_assert(sizeof(Color) == 4);
+
+class Codec;
+
+// Colors live in fixed-size chunks so that growing or shrinking a large
+// palette only allocates or frees the chunks at the tail. Chunks are
+// shared between copies and only cloned when one of them writes to it, so
+// copies, slices and undo snapshots cost memory only where they differ.
+// Reading through a const palette never clones.
 class Palette
 {
 public:
+    static constexpr size_t ChunkSize = 256;
+    static constexpr size_t MaxColors = 1 << 24;
+    static constexpr size_t MaxJascColors = 256;
+
     Palette();
     Palette(size_t i);
+    Palette(const Palette &other) = default;
+    Palette(Palette &&other) noexcept = default;
+    Palette &operator=(const Palette &other) = default;
+    Palette &operator=(Palette &&other) noexcept = default;
     ~Palette() = default;
 
+    // Without an explicit codec the format is detected from the data when
+    // loading, and taken from the file extension when saving (JASC-PAL if
+    // the extension is unknown).
     void LoadFromFile(const std::string &fname);
-    void LoadFromFile(std::ifstream &stream);
-    void SaveToFile(const std::string &fname);
-    void SaveToFile(std::ofstream &stream);
+    void LoadFromBuffer(std::span<const char> buffer, const Codec *codec = nullptr);
+    bool SaveToFile(const std::string &fname, const Codec *codec = nullptr) const;
+    void SaveToBuffer(std::string &buffer, const Codec *codec = nullptr) const;
+    void SnapTo15Bit();
+
+    // 64-bit hash of the colors only, independent of the file format. It is
+    // a sum of per-slot hashes, so single slots can be updated cheaply.
+    uint64_t Hash() const;
+
+    static constexpr uint64_t MixHash(uint64_t x)
+    {
+        x ^= x >> 30;
+        x *= 0xBF58476D1CE4E5B9ULL;
+        x ^= x >> 27;
+        x *= 0x94D049BB133111EBULL;
+        return x ^ (x >> 31);
+    }
 
-    constexpr Color &operator[](size_t idx) { return m_Colors[idx]; }
-    constexpr const Color &operator[](size_t idx) const { return m_Colors[idx]; }
+    static constexpr uint64_t SlotHash(size_t idx, const Color &color)
+    {
+        return MixHash((static_cast<uint64_t>(idx) << 32) | color.r | (color.g << 8) | (color.b << 16));
+    }
 
-    constexpr size_t size(void) { return m_Colors.size(); }
-    constexpr void resize(int size) { m_Colors.resize(size); }
+    static constexpr uint64_t SizeHash(size_t size) { return MixHash(size ^ 0x9E3779B97F4A7C15ULL); }
 
-    constexpr void clear() { m_Colors.clear(); }
-    void operator+=(const Palette &other) { m_Colors.insert(m_Colors.end(), other.m_Colors.begin(), other.m_Colors.end()); }
+    Color &operator[](size_t idx) { return MutableChunk(idx / ChunkSize)[idx % ChunkSize]; }
+    const Color &operator[](size_t idx) const { return (*m_Chunks[idx / ChunkSize])[idx % ChunkSize]; }
+
+    bool operator==(const Palette &other) const;
+
+    constexpr size_t size(void) const { return m_Size; }
+    void resize(size_t size);
+    void clear();
+    void push_back(const Color &color);
+
+    void CopyTo(size_t begin, size_t count, Color *out) const;
+    void CopyFrom(size_t begin, size_t count, const Color *in);
+    // Appending at a chunk boundary shares the chunks of other.
+    void operator+=(const Palette &other);
+    // Copy of [begin, begin + count). Shares all full chunks when begin is
+    // at a chunk boundary.
+    Palette Slice(size_t begin, size_t count) const;
+    // Writes source over [begin, begin + source.size()), sharing its full
+    // chunks when begin is at a chunk boundary.
+    void Paste(size_t begin, const Palette &source);
+
+    size_t GetChunkCount() const { return m_Chunks.size(); }
+    std::span<Color> GetChunk(size_t i) { return { MutableChunk(i).data(), ChunkLength(i) }; }
+    std::span<const Color> GetChunk(size_t i) const { return { m_Chunks[i]->data(), ChunkLength(i) }; }
+    // Number of chunks that are also used by another palette.
+    size_t GetSharedChunkCount() const;
+    // Bytes of color storage, with a shared chunk split evenly between the
+    // palettes using it.
+    size_t GetMemoryUsage() const;
+
+    // Three bytes per color, with runs of the same color stored once.
+    void Compress(std::string &out) const;
+    bool Decompress(std::span<const char> data);
 private:
-    std::vector<Color> m_Colors;
+    using Chunk = std::array<Color, ChunkSize>;
+
+    size_t ChunkLength(size_t i) const { return std::min(ChunkSize, m_Size - i * ChunkSize); }
+    // Clones the chunk first if another palette uses it too. Different
+    // chunks of one palette may be written from different threads.
+    Chunk &MutableChunk(size_t i)
+    {
+        if (m_Chunks[i].use_count() != 1)
+            m_Chunks[i] = std::make_shared<Chunk>(*m_Chunks[i]);
+        else
+            std::atomic_thread_fence(std::memory_order_acquire);
+        return *m_Chunks[i];
+    }
+
+    std::vector<std::shared_ptr<Chunk>> m_Chunks;
+    size_t m_Size = 0;
 };
 
-#endif // PALETTE_HPP
\ No newline at end of file
+#endif // PALETTE_HPP
@@ -4,6 +4,9 @@
 #include "popups.hpp"
 #include "palette.hpp"
 #include "context.hpp"
+#include "jobs.hpp"
+#include "swatch_view.hpp"
+#include <unordered_map>
 
 namespace Popups
 {
@@ -15,14 +18,32 @@ namespace Popups
         virtual void Draw() override;
         virtual void ProcessShortcuts(int key, int mods) override;
     private:
+        struct LoadedFile
+        {
+            Palette palette;
+            std::string error;
+        };
+
+        struct PendingLoad
+        {
+            std::vector<std::string> files;
+            std::shared_ptr<JobBatch<LoadedFile>> batch;
+        };
+
+        void LoadFiles(const std::vector<std::string> &files);
+        void CollectLoadedFiles();
         void CombineFiles();
         void FileDetails();
         void DetailsBar();
         void Load();
         void PaletteEditor();
         std::vector <std::string> m_Files;
+        std::unordered_map<std::string, Palette> m_LoadedFiles;
+        std::vector<PendingLoad> m_PendingLoads;
+        std::vector<std::string> m_Errors;
         Palette m_Palette;
+        SwatchView m_SwatchView{false};
     };
 }
 
-#endif // POPUPS_COMBINE_HPP
\ No newline at end of file
+#endif // POPUPS_COMBINE_HPP
\ No newline at end of file
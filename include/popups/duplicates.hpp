@@ -0,0 +1,24 @@
+#ifndef POPUPS_DUPLICATES_HPP
+#define POPUPS_DUPLICATES_HPP
+
+#include "popups.hpp"
+#include <string>
+#include <vector>
+
+namespace Popups
+{
+    // Lists open tabs whose palettes have the same colors.
+    class Duplicates final : public Popup
+    {
+    public:
+        Duplicates();
+        virtual void PreDraw() override;
+        virtual void Draw() override;
+        virtual void ProcessShortcuts(int key, int mods) override;
+    private:
+        void Refresh();
+        std::vector<std::vector<std::string>> m_Groups;
+    };
+}
+
+#endif // POPUPS_DUPLICATES_HPP
@@ -2,6 +2,7 @@
 #define POPUPS_LOGGER_HPP
 
 #include "popups.hpp"
+#include <string>
 
 namespace Popups
 {
@@ -11,7 +12,10 @@ namespace Popups
         Logger();
         virtual void PreDraw() override;
         virtual void Draw() override;
+    private:
+        void Export(const char *path);
+        std::string m_Message;
     };
 }
 
-#endif // POPUPS_LOGGER_HPP
\ No newline at end of file
+#endif // POPUPS_LOGGER_HPP
\ No newline at end of file
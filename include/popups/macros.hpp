@@ -0,0 +1,34 @@
+#ifndef POPUPS_MACROS_HPP
+#define POPUPS_MACROS_HPP
+
+#include "popups.hpp"
+#include "macro.hpp"
+#include "jobs.hpp"
+#include <string>
+#include <vector>
+#include <memory>
+
+namespace Popups
+{
+    // Applies the recorded macro to open tabs or to files on disk, and
+    // saves or loads it.
+    class Macros final : public Popup
+    {
+    public:
+        Macros(std::shared_ptr<Macro> macro);
+        virtual void PreDraw() override;
+        virtual void Draw() override;
+        virtual void ProcessShortcuts(int key, int mods) override;
+    private:
+        void ApplyToTabs();
+        void ApplyToFiles(const std::vector<std::string> &files);
+        void CollectAppliedFiles();
+
+        std::shared_ptr<Macro> m_Macro;
+        std::vector<std::string> m_Files;
+        std::shared_ptr<JobBatch<std::string>> m_Pending;
+        std::vector<std::string> m_Messages;
+    };
+}
+
+#endif // POPUPS_MACROS_HPP
@@ -0,0 +1,42 @@
+#ifndef POPUPS_TRANSFORM_COLORS_HPP
+#define POPUPS_TRANSFORM_COLORS_HPP
+
+#include "popups.hpp"
+#include "transform.hpp"
+#include <vector>
+
+struct Context;
+
+namespace Popups
+{
+    // Adjusts a range of the current palette. The palette shows the result
+    // while the sliders move; it only becomes an undo step when applied.
+    class TransformColors final : public Popup
+    {
+    public:
+        TransformColors();
+        virtual void PreDraw() override;
+        virtual void Draw() override;
+        virtual void ProcessShortcuts(int key, int mods) override;
+    private:
+        Transform GetTransform() const;
+        void UpdatePreview();
+        void RestoreOriginal();
+        void Apply();
+
+        Context &m_Context;
+
+        int m_Type = 0;
+        int m_Hue = 0, m_Saturation = 0, m_Value = 0;
+        float m_Gamma = 1.0f;
+        int m_Brightness = 0, m_Contrast = 0;
+        int m_First = 0, m_Last = 0;
+
+        // Colors of the previewed range before the transform.
+        std::vector<Color> m_Original;
+        size_t m_PreviewBegin = 0;
+        Transform m_Previewed = Transform::HueSaturationValue(0, 0, 0);
+    };
+}
+
+#endif // POPUPS_TRANSFORM_COLORS_HPP
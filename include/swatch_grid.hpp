@@ -0,0 +1,54 @@
+#ifndef SWATCH_GRID_HPP
+#define SWATCH_GRID_HPP
+
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include "palette.hpp"
+
+// Layout of a palette as rows of square swatches. Positions are whole
+// pixels relative to the top-left corner of the grid, so hit-testing is
+// plain arithmetic and the same layout can be drawn by the editor or
+// rasterized without a window.
+class SwatchGrid
+{
+public:
+    static constexpr int MinCellSize = 2;
+    static constexpr int MaxCellSize = 64;
+
+    struct Rect
+    {
+        int x0, y0, x1, y1;
+    };
+
+    SwatchGrid(size_t columns = 16, int cellSize = 16, int gap = 1);
+
+    size_t GetColumns() const { return m_Columns; }
+    void SetColumns(size_t columns) { m_Columns = std::max<size_t>(1, columns); }
+    // As many columns as fit into width.
+    void FitColumns(int width) { SetColumns(width > 0 ? width / m_CellSize : 1); }
+
+    int GetCellSize() const { return m_CellSize; }
+    void SetCellSize(int cellSize);
+    int GetGap() const { return m_Gap; }
+
+    int GetWidth() const { return static_cast<int>(m_Columns) * m_CellSize; }
+    size_t GetRowCount(size_t numColors) const { return (numColors + m_Columns - 1) / m_Columns; }
+
+    // The swatch without the gap that follows it.
+    Rect GetSwatchRect(size_t idx) const;
+    // The gaps count toward the swatch before them, so dragging across
+    // the grid never falls through. SIZE_MAX outside of the swatches.
+    size_t HitTest(int x, int y, size_t numColors) const;
+
+    // RGBA image of rows [firstRow, firstRow + numRows), GetWidth() pixels
+    // wide. Gaps and cells past the end of the palette stay transparent.
+    void Rasterize(const Palette &palette, size_t firstRow, size_t numRows, std::vector<uint8_t> &rgba) const;
+private:
+    size_t m_Columns;
+    int m_CellSize;
+    int m_Gap;
+};
+
+#endif // SWATCH_GRID_HPP
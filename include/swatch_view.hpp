@@ -0,0 +1,33 @@
+#ifndef SWATCH_VIEW_HPP
+#define SWATCH_VIEW_HPP
+
+#include <cstdint>
+#include "palette.hpp"
+#include "swatch_grid.hpp"
+
+// Draws a palette as a SwatchGrid inside a child window. Only the visible
+// rows are drawn, one filled rectangle per swatch straight into the draw
+// list, and the mouse is mapped to swatches with SwatchGrid::HitTest
+// instead of one widget per color.
+class SwatchView
+{
+public:
+    // A read-only view selects but does not drag.
+    explicit SwatchView(bool allowSwap = true) : m_AllowSwap(allowSwap) { }
+
+    // Returns true when a swatch was dropped onto another one this frame;
+    // GetSwap tells which.
+    bool Draw(const char *id, const Palette &palette);
+    void GetSwap(size_t &from, size_t &to) const { from = m_SwapFrom; to = m_SwapTo; }
+
+    size_t GetSelected() const { return m_Selected; }
+    void SetSelected(size_t idx) { m_Selected = idx; }
+private:
+    SwatchGrid m_Grid;
+    bool m_AllowSwap;
+    size_t m_Selected = SIZE_MAX;
+    size_t m_DragFrom = SIZE_MAX;
+    size_t m_SwapFrom = 0, m_SwapTo = 0;
+};
+
+#endif // SWATCH_VIEW_HPP
@@ -0,0 +1,88 @@
+#ifndef TEXT_SCANNER_HPP
+#define TEXT_SCANNER_HPP
+
+#include <cstddef>
+#include <span>
+#include <string_view>
+
+// Minimal tokenizer for the text palette formats. Works directly on a
+// (possibly memory-mapped) buffer and never allocates.
+class TextScanner
+{
+public:
+    TextScanner(std::span<const char> buffer) : m_Cur(buffer.data()), m_End(buffer.data() + buffer.size()) { }
+
+    bool AtEnd() const { return m_Cur == m_End; }
+    size_t Remaining() const { return static_cast<size_t>(m_End - m_Cur); }
+
+    std::string_view NextToken()
+    {
+        SkipWhitespace();
+        const char *start = m_Cur;
+        while (m_Cur != m_End && !IsWhitespace(*m_Cur))
+            ++m_Cur;
+        return { start, static_cast<size_t>(m_Cur - start) };
+    }
+
+    // Returns the rest of the current line without the line break and
+    // moves to the start of the next one.
+    std::string_view NextLine()
+    {
+        const char *start = m_Cur;
+        while (m_Cur != m_End && *m_Cur != '\n')
+            ++m_Cur;
+
+        const char *end = m_Cur;
+        if (end != start && end[-1] == '\r')
+            --end;
+        if (m_Cur != m_End)
+            ++m_Cur;
+
+        return { start, static_cast<size_t>(end - start) };
+    }
+
+    bool NextInt(long &value)
+    {
+        SkipWhitespace();
+
+        bool negative = false;
+        if (m_Cur != m_End && (*m_Cur == '-' || *m_Cur == '+'))
+            negative = *m_Cur++ == '-';
+
+        const char *start = m_Cur;
+        unsigned long result = 0;
+        while (m_Cur != m_End && static_cast<unsigned char>(*m_Cur - '0') < 10)
+        {
+            // Saturate instead of overflowing, the caller range checks anyway.
+            if (result < 100000000UL)
+                result = result * 10 + (*m_Cur - '0');
+            ++m_Cur;
+        }
+
+        if (m_Cur == start)
+            return false;
+
+        value = negative ? -static_cast<long>(result) : static_cast<long>(result);
+        return true;
+    }
+
+    static constexpr bool IsWhitespace(char c) { return c == ' ' || (c >= '\t' && c <= '\r'); }
+
+    static constexpr int HexValue(char c)
+    {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+private:
+    void SkipWhitespace()
+    {
+        while (m_Cur != m_End && IsWhitespace(*m_Cur))
+            ++m_Cur;
+    }
+
+    const char *m_Cur, *m_End;
+};
+
+#endif // TEXT_SCANNER_HPP
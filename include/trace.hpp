@@ -0,0 +1,67 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Scoped timing zones, written as Chrome trace JSON (chrome://tracing or
+// ui.perfetto.dev). Every thread records into its own fixed-size ring
+// buffer without locking; the oldest zones are overwritten when it is
+// full. Recording is off until Trace::SetEnabled(true), and a disabled
+// zone costs one relaxed load. Building with PALETTE_EDITOR_TRACING off
+// removes the zones altogether.
+class Trace
+{
+public:
+    // Zones kept per thread.
+    static constexpr size_t BufferSize = 1 << 16;
+
+    static bool IsEnabled() { return s_Enabled.load(std::memory_order_relaxed); }
+    static void SetEnabled(bool enabled);
+
+    // Shown instead of the thread number in the trace viewer.
+    static void SetThreadName(const char *name);
+
+    // Nanoseconds since the first call.
+    static uint64_t Now();
+
+    // name must outlive the trace, normally it is a string literal.
+    static void Record(const char *name, uint64_t start, uint64_t end);
+
+    // Zones recorded so far on every thread. Threads keep recording while
+    // this runs; zones overwritten meanwhile are left out.
+    static void Export(std::string &out);
+    static bool Save(const std::string &fname);
+    static void Clear();
+private:
+    static std::atomic<bool> s_Enabled;
+};
+
+class TraceScope
+{
+public:
+    explicit TraceScope(const char *name) : m_Name(name), m_Start(Trace::IsEnabled() ? Trace::Now() : 0) { }
+    ~TraceScope()
+    {
+        if (m_Start)
+            Trace::Record(m_Name, m_Start, Trace::Now());
+    }
+
+    TraceScope(const TraceScope &) = delete;
+    TraceScope &operator=(const TraceScope &) = delete;
+private:
+    const char *m_Name;
+    uint64_t m_Start;
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+
+#ifdef PALETTE_EDITOR_TRACING
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope_, __LINE__)(name)
+#else
+#define TRACE_SCOPE(name) ((void)0)
+#endif
+
+#endif // TRACE_HPP
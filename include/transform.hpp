@@ -0,0 +1,56 @@
+#ifndef TRANSFORM_HPP
+#define TRANSFORM_HPP
+
+#include <span>
+#include <cstdint>
+#include "palette.hpp"
+
+// Color adjustment applied to a range of a palette. The parameters are
+// stored quantized in three bytes, so a transform fits into an undo record
+// and applying it again always gives the same colors.
+//
+//  HueSaturationValue  a: hue shift in 1/256 turns, b/c: saturation and
+//                      value change in percent (-100 to 100)
+//  Gamma               a: gamma is 10^(a/100)
+//  BrightnessContrast  a: brightness in percent, b: contrast in percent
+//  Invert, Grayscale,  no parameters
+//  Snap15Bit
+struct Transform
+{
+    enum class Type : uint8_t
+    {
+        HueSaturationValue,
+        Gamma,
+        BrightnessContrast,
+        Invert,
+        Grayscale,
+        Snap15Bit,
+        Count,
+    };
+
+    Type type;
+    int8_t a = 0, b = 0, c = 0;
+
+    static Transform HueSaturationValue(int hueDegrees, int saturation, int value);
+    static Transform Gamma(float gamma);
+    static Transform BrightnessContrast(int brightness, int contrast);
+    static Transform Invert() { return { Type::Invert }; }
+    static Transform Grayscale() { return { Type::Grayscale }; }
+    static Transform Snap15Bit() { return { Type::Snap15Bit }; }
+
+    static const char *GetTypeName(Type type);
+    const char *GetName() const { return GetTypeName(type); }
+
+    int GetHueDegrees() const { return a * 360 / 256; }
+    float GetGamma() const;
+    bool IsIdentity() const;
+    bool operator==(const Transform &) const = default;
+
+    void Apply(std::span<Color> colors) const;
+    // Large ranges are split over the job system.
+    void Apply(Palette &palette, size_t begin, size_t count) const;
+};
+
+static_assert(sizeof(Transform) == 4);
+
+#endif // TRANSFORM_HPP
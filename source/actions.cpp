@@ -1,33 +1,462 @@
 #include "actions.hpp"
+#include "trace.hpp"
+#include <algorithm>
+
+ActionRegister::Limits ActionRegister::s_DefaultLimits;
+
+template<typename T>
+concept HasRemovedColors = requires(const T &action) { action.RemovedCount(); };
+
+static bool HasRemoved(const ActionRecord &record)
+{
+    return std::visit([](const auto &action) {
+        return HasRemovedColors<std::decay_t<decltype(action)>>;
+    }, record);
+}
+
+// Sum of the slot hashes an action changes, as the palette is now. The
+// palette hash moves by the difference of this before and after the
+// action. Edits use the colors of the record instead, since the editor
+// already shows the new color while it is being dragged.
+static uint64_t TouchedHash(const Palette &palette, const ActionRecord &record)
+{
+    if (auto swap = std::get_if<Actions::SwapColors>(&record))
+        return Palette::SlotHash(swap->first, palette[swap->first]) + (swap->first != swap->second ? Palette::SlotHash(swap->second, palette[swap->second]) : 0);
+
+    size_t begin, end;
+    uint64_t hash = 0;
+    if (auto change = std::get_if<Actions::ChangeColorCount>(&record))
+    {
+        begin = std::min(change->oldSize, change->newSize);
+        end = palette.size();
+        hash = Palette::SizeHash(palette.size());
+    }
+    else
+    {
+        auto &transform = std::get<Actions::TransformColors>(record);
+        begin = transform.begin;
+        end = transform.begin + transform.count;
+    }
+
+    for (size_t i = begin; i < end; ++i)
+        hash += Palette::SlotHash(i, palette[i]);
+    return hash;
+}
+
+ActionRegister::ActionRegister(Palette &palette) : m_Palette(palette)
+{
+    Rehash();
+    SetLimits(s_DefaultLimits);
+}
+
+void ActionRegister::ApplyRecord(const ActionRecord &record)
+{
+    if (auto edit = std::get_if<Actions::ModifyColor>(&record))
+    {
+        m_Hash += Palette::SlotHash(edit->index, edit->newColor) - Palette::SlotHash(edit->index, edit->oldColor);
+        edit->Apply(m_Palette);
+        return;
+    }
+
+    uint64_t before = TouchedHash(m_Palette, record);
+    std::visit([this](const auto &action) { action.Apply(m_Palette); }, record);
+    m_Hash += TouchedHash(m_Palette, record) - before;
+}
+
+void ActionRegister::Push(const ActionRecord &record)
+{
+    TRACE_SCOPE("ActionRegister::Push");
+    auto edit = std::get_if<Actions::ModifyColor>(&record);
+    if (edit && CanCoalesce(*edit))
+    {
+        Amend(*edit);
+        Notify(HistoryEvent::Type::Amend, record);
+    }
+    else
+    {
+        PushRecord(record);
+        Notify(HistoryEvent::Type::Push, record);
+    }
+
+    m_LastPush = std::chrono::steady_clock::now();
+}
+
+void ActionRegister::PushRecord(const ActionRecord &record)
+{
+    ClearRedoStack();
+
+    std::visit([this](const auto &action) {
+        if constexpr (HasRemovedColors<std::decay_t<decltype(action)>>)
+        {
+            m_Removed.push_back(action.Capture(m_Palette));
+            m_RemovedColors += m_Removed.back().size();
+            ++m_RemovedCursor;
+        }
+    }, record);
+
+    ApplyRecord(record);
+
+    bool joined = InTransaction() && m_TransactionSize > 0;
+    if (!joined && m_Limits.maxActions != 0 && m_Steps >= m_Limits.maxActions)
+        EvictOldestStep();
+    if (m_Count == m_Records.size())
+        Reserve(std::max<size_t>(64, m_Records.size() * 2));
+
+    m_Records[Slot(m_Count)] = record;
+    m_Joined[Slot(m_Count)] = joined;
+    ++m_Count;
+    ++m_Cursor;
+
+    if (!joined)
+    {
+        ++m_Steps;
+        ++m_StepCursor;
+    }
+    if (InTransaction())
+        ++m_TransactionSize;
+
+    m_CanCoalesce = true;
+
+    EnforceLimits();
+}
+
+bool ActionRegister::CanCoalesce(const Actions::ModifyColor &edit) const
+{
+    if (!m_CanCoalesce || m_Cursor == 0 || m_Cursor != m_Count)
+        return false;
+
+    if (InTransaction() ? m_TransactionSize == 0 : std::chrono::steady_clock::now() - m_LastPush > m_CoalesceWindow)
+        return false;
+
+    auto top = std::get_if<Actions::ModifyColor>(&m_Records[Slot(m_Cursor - 1)]);
+    return top && top->index == edit.index;
+}
+
+void ActionRegister::Amend(const Actions::ModifyColor &edit)
+{
+    auto &top = std::get<Actions::ModifyColor>(m_Records[Slot(m_Cursor - 1)]);
+    m_Hash += Palette::SlotHash(edit.index, edit.newColor) - Palette::SlotHash(top.index, top.newColor);
+    top.newColor = edit.newColor;
+    edit.Apply(m_Palette);
+}
+
+void ActionRegister::Notify(HistoryEvent::Type type, const ActionRecord &record)
+{
+    if (m_Observer)
+        m_Observer({ type, record });
+}
+
+void ActionRegister::Replay(const HistoryEvent &event)
+{
+    auto observer = std::move(m_Observer);
+    m_Observer = nullptr;
+
+    switch (event.type)
+    {
+    case HistoryEvent::Type::Push:
+        PushRecord(event.record);
+        break;
+    case HistoryEvent::Type::Amend:
+        if (auto edit = std::get_if<Actions::ModifyColor>(&event.record); edit && m_Cursor > 0 && m_Cursor == m_Count &&
+            std::holds_alternative<Actions::ModifyColor>(GetRecord(m_Cursor - 1)))
+            Amend(*edit);
+        break;
+    case HistoryEvent::Type::Undo:
+        Undo();
+        break;
+    case HistoryEvent::Type::Redo:
+        Redo();
+        break;
+    case HistoryEvent::Type::BeginTransaction:
+        BeginTransaction();
+        break;
+    case HistoryEvent::Type::CommitTransaction:
+        CommitTransaction();
+        break;
+    case HistoryEvent::Type::RollbackTransaction:
+        RollbackTransaction();
+        break;
+    case HistoryEvent::Type::ClearUndo:
+        ClearUndoStack();
+        break;
+    }
+
+    m_Observer = std::move(observer);
+}
+
+void ActionRegister::BeginTransaction()
+{
+    if (m_TransactionDepth++ == 0)
+        m_TransactionSize = 0;
+
+    Notify(HistoryEvent::Type::BeginTransaction);
+}
+
+void ActionRegister::CommitTransaction()
+{
+    if (m_TransactionDepth == 0)
+        return;
+
+    // Later edits must not be folded into the finished transaction.
+    if (--m_TransactionDepth == 0)
+        m_CanCoalesce = false;
+
+    Notify(HistoryEvent::Type::CommitTransaction);
+}
+
+void ActionRegister::RollbackTransaction()
+{
+    if (m_TransactionDepth == 0)
+        return;
+
+    if (m_TransactionSize > 0)
+    {
+        for (; m_TransactionSize > 0; --m_TransactionSize)
+            RevertTop();
+
+        --m_StepCursor;
+        ClearRedoStack();
+    }
+
+    m_TransactionDepth = 0;
+    m_CanCoalesce = false;
+
+    Notify(HistoryEvent::Type::RollbackTransaction);
+}
+
+void ActionRegister::RevertTop()
+{
+    const auto &record = GetRecord(m_Cursor - 1);
+    if (auto edit = std::get_if<Actions::ModifyColor>(&record))
+    {
+        m_Hash += Palette::SlotHash(edit->index, edit->oldColor) - Palette::SlotHash(edit->index, edit->newColor);
+        edit->Revert(m_Palette);
+    }
+    else
+    {
+        uint64_t before = TouchedHash(m_Palette, record);
+        std::visit([this](const auto &action) {
+            if constexpr (HasRemovedColors<std::decay_t<decltype(action)>>)
+                action.Revert(m_Palette, m_Removed[--m_RemovedCursor]);
+            else
+                action.Revert(m_Palette);
+        }, record);
+        m_Hash += TouchedHash(m_Palette, record) - before;
+    }
+
+    --m_Cursor;
+}
 
 void ActionRegister::Undo()
 {
-    if (m_UndoStack.empty())
+    TRACE_SCOPE("ActionRegister::Undo");
+    if (!CanUndo())
         return;
 
-    auto action = m_UndoStack.front();
-    action->Revert();
-    m_UndoStack.pop_front();
-    m_RedoStack.push_front(action);
+    // A whole transaction is reverted in this one loop.
+    bool joined;
+    do
+    {
+        joined = IsJoined(m_Cursor - 1);
+        RevertTop();
+    } while (joined);
+
+    --m_StepCursor;
+    m_CanCoalesce = false;
+
+    Notify(HistoryEvent::Type::Undo);
 }
 
 void ActionRegister::Redo()
 {
-    if (m_RedoStack.empty())
+    TRACE_SCOPE("ActionRegister::Redo");
+    if (!CanRedo())
         return;
 
-    auto action = m_RedoStack.front();
-    action->Apply();
-    m_RedoStack.pop_front();
-    m_UndoStack.push_front(action);
+    do
+    {
+        const auto &record = GetRecord(m_Cursor);
+        ApplyRecord(record);
+        m_RemovedCursor += HasRemoved(record);
+        ++m_Cursor;
+    } while (m_Cursor < m_Count && IsJoined(m_Cursor));
+
+    ++m_StepCursor;
+    m_CanCoalesce = false;
+
+    Notify(HistoryEvent::Type::Redo);
 }
 
 void ActionRegister::ClearUndoStack()
 {
-    m_UndoStack.clear();
+    while (m_StepCursor > 0)
+        EvictOldestStep();
+
+    Notify(HistoryEvent::Type::ClearUndo);
+}
+
+ActionRegister::State ActionRegister::GetState() const
+{
+    State state;
+    state.records.reserve(m_Count);
+    state.joined.reserve(m_Count);
+    for (size_t i = 0; i < m_Count; ++i)
+    {
+        state.records.push_back(GetRecord(i));
+        state.joined.push_back(IsJoined(i));
+    }
+
+    state.cursor = m_Cursor;
+    state.removed.reserve(m_RemovedColors);
+    for (size_t i = m_RemovedBegin; i < m_Removed.size(); ++i)
+    {
+        if (i == m_RemovedCursor)
+            state.removedCursor = state.removed.size();
+
+        size_t offset = state.removed.size();
+        state.removed.resize(offset + m_Removed[i].size());
+        m_Removed[i].CopyTo(0, m_Removed[i].size(), state.removed.data() + offset);
+    }
+    if (m_RemovedCursor == m_Removed.size())
+        state.removedCursor = state.removed.size();
+    return state;
+}
+
+void ActionRegister::SetState(State &&state)
+{
+    m_Records = std::move(state.records);
+    m_Joined = std::move(state.joined);
+    m_Head = 0;
+    m_Count = m_Records.size();
+    m_Cursor = std::min(state.cursor, m_Count);
+
+    // A joined first record would have no step to belong to.
+    if (m_Count > 0)
+        m_Joined[0] = 0;
+
+    m_Steps = m_StepCursor = 0;
+    for (size_t i = 0; i < m_Count; ++i)
+    {
+        if (!m_Joined[i])
+        {
+            ++m_Steps;
+            m_StepCursor += i < m_Cursor;
+        }
+    }
+
+    // The flat colors are cut back into one slice per record.
+    m_Removed.clear();
+    m_RemovedBegin = m_RemovedCursor = m_RemovedColors = 0;
+    for (size_t i = 0; i < m_Count; ++i)
+    {
+        size_t count = std::visit([](const auto &action) -> size_t {
+            if constexpr (HasRemovedColors<std::decay_t<decltype(action)>>)
+                return action.RemovedCount();
+            else
+                return SIZE_MAX;
+        }, m_Records[i]);
+        if (count == SIZE_MAX)
+            continue;
+
+        count = std::min(count, state.removed.size() - m_RemovedColors);
+        auto &removed = m_Removed.emplace_back(count);
+        removed.CopyFrom(0, count, state.removed.data() + m_RemovedColors);
+        m_RemovedColors += count;
+        m_RemovedCursor += i < m_Cursor;
+    }
+
+    m_TransactionDepth = m_TransactionSize = 0;
+    m_CanCoalesce = false;
+
+    Rehash();
+    SetLimits(m_Limits);
 }
 
 void ActionRegister::ClearRedoStack()
 {
-    m_RedoStack.clear();
+    m_Count = m_Cursor;
+    m_Steps = m_StepCursor;
+    for (size_t i = m_RemovedCursor; i < m_Removed.size(); ++i)
+        m_RemovedColors -= m_Removed[i].size();
+    m_Removed.resize(m_RemovedCursor);
+}
+
+size_t ActionRegister::GetMemoryUsage() const
+{
+    return m_Count * (sizeof(ActionRecord) + 1) + m_RemovedColors * sizeof(Color);
+}
+
+void ActionRegister::SetLimits(const Limits &limits)
+{
+    m_Limits = limits;
+
+    // A fixed depth gets its whole ring up front, so pushing single
+    // actions never allocates.
+    if (m_Limits.maxActions != 0 && m_Limits.maxActions <= (1 << 20))
+        Reserve(m_Limits.maxActions);
+
+    EnforceLimits();
+}
+
+void ActionRegister::Reserve(size_t capacity)
+{
+    if (capacity <= m_Records.size())
+        return;
+
+    // Unrolls the ring so the oldest record is at index 0 again.
+    std::vector<ActionRecord> records;
+    std::vector<uint8_t> joined;
+    records.reserve(capacity);
+    joined.reserve(capacity);
+    for (size_t i = 0; i < m_Count; ++i)
+    {
+        records.push_back(GetRecord(i));
+        joined.push_back(IsJoined(i));
+    }
+    records.resize(capacity, Actions::SwapColors(0, 0));
+    joined.resize(capacity, 0);
+
+    m_Records = std::move(records);
+    m_Joined = std::move(joined);
+    m_Head = 0;
+}
+
+void ActionRegister::EvictOldestStep()
+{
+    do
+    {
+        if (HasRemoved(GetRecord(0)))
+        {
+            m_RemovedColors -= m_Removed[m_RemovedBegin].size();
+            m_Removed[m_RemovedBegin++].clear();
+        }
+        m_Head = (m_Head + 1) % m_Records.size();
+        --m_Count;
+        --m_Cursor;
+    } while (m_Cursor > 0 && IsJoined(0));
+
+    --m_Steps;
+    --m_StepCursor;
+
+    // Moves the live slices back to the front once half of the buffer is
+    // dead, which keeps the buffer from growing forever.
+    if (m_RemovedBegin > 0 && m_RemovedBegin * 2 >= m_Removed.size())
+    {
+        m_Removed.erase(m_Removed.begin(), m_Removed.begin() + m_RemovedBegin);
+        m_RemovedCursor -= m_RemovedBegin;
+        m_RemovedBegin = 0;
+    }
+}
+
+void ActionRegister::EnforceLimits()
+{
+    // The newest step is always kept, even if it alone is over budget. It
+    // may also be an open transaction, which must stay whole.
+    auto overLimit = [this]() {
+        return (m_Limits.maxActions != 0 && m_Steps > m_Limits.maxActions) ||
+            (m_Limits.maxBytes != 0 && GetMemoryUsage() > m_Limits.maxBytes);
+    };
+
+    while (m_StepCursor > 1 && overLimit())
+        EvictOldestStep();
 }
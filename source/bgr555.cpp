@@ -0,0 +1,118 @@
+#include "bgr555.hpp"
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define BGR555_AVX2
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define BGR555_SSE2
+#endif
+
+// The vector paths treat a Color as the little-endian word 0x00BBGGRR and
+// assume a little-endian host, which holds for every x86 target.
+
+namespace
+{
+#if defined(BGR555_SSE2)
+    inline __m128i PackWords(__m128i x)
+    {
+        __m128i r = _mm_and_si128(_mm_srli_epi32(x, 3), _mm_set1_epi32(0x001F));
+        __m128i g = _mm_and_si128(_mm_srli_epi32(x, 6), _mm_set1_epi32(0x03E0));
+        __m128i b = _mm_and_si128(_mm_srli_epi32(x, 9), _mm_set1_epi32(0x7C00));
+        return _mm_or_si128(r, _mm_or_si128(g, b));
+    }
+
+    inline __m128i UnpackWords(__m128i v)
+    {
+        __m128i r = _mm_and_si128(v, _mm_set1_epi32(0x00001F));
+        __m128i g = _mm_and_si128(_mm_slli_epi32(v, 3), _mm_set1_epi32(0x001F00));
+        __m128i b = _mm_and_si128(_mm_slli_epi32(v, 6), _mm_set1_epi32(0x1F0000));
+        __m128i c = _mm_or_si128(r, _mm_or_si128(g, b));
+        __m128i hi = _mm_slli_epi32(c, 3);
+        __m128i lo = _mm_and_si128(_mm_srli_epi32(c, 2), _mm_set1_epi32(0x070707));
+        return _mm_or_si128(hi, lo);
+    }
+#endif
+
+#if defined(BGR555_AVX2)
+    inline __m256i PackWords(__m256i x)
+    {
+        __m256i r = _mm256_and_si256(_mm256_srli_epi32(x, 3), _mm256_set1_epi32(0x001F));
+        __m256i g = _mm256_and_si256(_mm256_srli_epi32(x, 6), _mm256_set1_epi32(0x03E0));
+        __m256i b = _mm256_and_si256(_mm256_srli_epi32(x, 9), _mm256_set1_epi32(0x7C00));
+        return _mm256_or_si256(r, _mm256_or_si256(g, b));
+    }
+#endif
+}
+
+namespace bgr555
+{
+    void Pack(std::span<const Color> in, uint16_t *out)
+    {
+        size_t i = 0;
+        const Color *src = in.data();
+
+#if defined(BGR555_AVX2)
+        for (; i + 16 <= in.size(); i += 16)
+        {
+            __m256i a = PackWords(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i)));
+            __m256i b = PackWords(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i + 8)));
+            // packs works per 128-bit lane, restore the order afterwards.
+            __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), 0xD8);
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), packed);
+        }
+#endif
+
+#if defined(BGR555_SSE2)
+        for (; i + 8 <= in.size(); i += 8)
+        {
+            __m128i a = PackWords(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i)));
+            __m128i b = PackWords(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i + 4)));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), _mm_packs_epi32(a, b));
+        }
+#endif
+
+        for (; i < in.size(); ++i)
+            out[i] = Pack(src[i]);
+    }
+
+    void Unpack(std::span<const uint16_t> in, Color *out)
+    {
+        size_t i = 0;
+        const uint16_t *src = in.data();
+
+#if defined(BGR555_SSE2)
+        const __m128i zero = _mm_setzero_si128();
+        for (; i + 8 <= in.size(); i += 8)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), UnpackWords(_mm_unpacklo_epi16(v, zero)));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i + 4), UnpackWords(_mm_unpackhi_epi16(v, zero)));
+        }
+#endif
+
+        for (; i < in.size(); ++i)
+            out[i] = Unpack(src[i]);
+    }
+
+    void Snap(std::span<Color> colors)
+    {
+        size_t i = 0;
+        Color *data = colors.data();
+
+#if defined(BGR555_SSE2)
+        for (; i + 4 <= colors.size(); i += 4)
+        {
+            __m128i x = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i)), _mm_set1_epi32(0xF8F8F8));
+            __m128i lo = _mm_and_si128(_mm_srli_epi32(x, 5), _mm_set1_epi32(0x070707));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(data + i), _mm_or_si128(x, lo));
+        }
+#endif
+
+        for (; i < colors.size(); ++i)
+            data[i] = Snap(data[i]);
+    }
+}
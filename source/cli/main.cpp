@@ -0,0 +1,481 @@
+#include "palette.hpp"
+#include "codecs.hpp"
+#include "io.hpp"
+#include "dedupe.hpp"
+#include "macro.hpp"
+#include "jobs.hpp"
+#include "swatch_grid.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+namespace
+{
+    // Far past any useful core count, only there to catch typos.
+    constexpr unsigned MaxJobs = 256;
+
+    enum class Command
+    {
+        Validate,
+        Convert,
+        Normalize,
+        Dedupe,
+        Macro,
+        Render,
+    };
+
+    struct Options
+    {
+        Command command;
+        const Codec *format = nullptr;
+        std::string outputDir;
+        std::string indexFile;
+        std::string traceFile;
+        Macro macro;
+        bool recursive = false;
+        bool quiet = false;
+        unsigned jobs = 0;
+        size_t columns = 16;
+        int cellSize = 16;
+        std::vector<std::string> inputs;
+    };
+
+    struct FileResult
+    {
+        std::string error;
+        size_t bytesRead = 0;
+        size_t numColors = 0;
+        bool written = false;
+    };
+
+    void PrintUsage()
+    {
+        std::fputs(
+            "usage: palette-cli <command> [options] <files or directories...>\n"
+            "\n"
+            "commands:\n"
+            "  validate           parse every file and report errors\n"
+            "  convert            convert every file to --format\n"
+            "  normalize          rewrite every file in its own format\n"
+            "  dedupe             list files with identical colors\n"
+            "  macro              apply the --macro to every file in place\n"
+            "  render             draw every file as a grid of swatches into a .ppm image\n"
+            "\n"
+            "options:\n"
+            "  -f, --format NAME  output format for convert\n"
+            "  -o, --output DIR   output directory for convert and render (default: next to the input)\n"
+            "  -r, --recursive    descend into directories\n"
+            "  -i, --index FILE   hash cache for dedupe, only changed files are rehashed\n"
+            "  -m, --macro FILE   macro recorded in the editor, for macro\n"
+            "  -c, --columns N    swatches per row for render (default: 16)\n"
+            "  -s, --size N       swatch size in pixels for render (default: 16)\n"
+            "  -t, --trace FILE   write a Chrome trace of the run to FILE\n"
+            "  -j, --jobs N       number of worker threads (default: all cores)\n"
+            "  -q, --quiet        only print errors and the summary\n"
+            "\n"
+            "formats:\n",
+            stderr
+        );
+
+        for (auto codec : Codecs::GetAll())
+            std::fprintf(stderr, "  %-18s %s\n", codec->GetName(), codec->GetDescription());
+    }
+
+    bool ParseArguments(int argc, char *argv[], Options &options)
+    {
+        if (argc < 2)
+            return false;
+
+        if (!std::strcmp(argv[1], "validate"))
+            options.command = Command::Validate;
+        else if (!std::strcmp(argv[1], "convert"))
+            options.command = Command::Convert;
+        else if (!std::strcmp(argv[1], "normalize"))
+            options.command = Command::Normalize;
+        else if (!std::strcmp(argv[1], "dedupe"))
+            options.command = Command::Dedupe;
+        else if (!std::strcmp(argv[1], "macro"))
+            options.command = Command::Macro;
+        else if (!std::strcmp(argv[1], "render"))
+            options.command = Command::Render;
+        else
+            return false;
+
+        std::string macroFile;
+        for (int i = 2; i < argc; ++i)
+        {
+            std::string arg = argv[i];
+            bool hasValue = i + 1 < argc;
+
+            if ((arg == "-f" || arg == "--format") && hasValue)
+            {
+                options.format = Codecs::FindByName(argv[++i]);
+                if (!options.format)
+                {
+                    std::fprintf(stderr, "Unknown format \"%s\".\n", argv[i]);
+                    return false;
+                }
+            }
+            else if ((arg == "-o" || arg == "--output") && hasValue)
+                options.outputDir = argv[++i];
+            else if ((arg == "-i" || arg == "--index") && hasValue)
+                options.indexFile = argv[++i];
+            else if ((arg == "-m" || arg == "--macro") && hasValue)
+            {
+                macroFile = argv[++i];
+                if (!options.macro.Load(macroFile))
+                {
+                    std::fprintf(stderr, "Could not load macro \"%s\".\n", argv[i]);
+                    return false;
+                }
+            }
+            else if ((arg == "-c" || arg == "--columns") && hasValue)
+                options.columns = std::max(1, std::atoi(argv[++i]));
+            else if ((arg == "-s" || arg == "--size") && hasValue)
+            {
+                options.cellSize = std::atoi(argv[++i]);
+                if (options.cellSize < SwatchGrid::MinCellSize || options.cellSize > SwatchGrid::MaxCellSize)
+                {
+                    std::fprintf(stderr, "Swatch size must be between %d and %d.\n", SwatchGrid::MinCellSize, SwatchGrid::MaxCellSize);
+                    return false;
+                }
+            }
+            else if ((arg == "-t" || arg == "--trace") && hasValue)
+                options.traceFile = argv[++i];
+            else if ((arg == "-j" || arg == "--jobs") && hasValue)
+            {
+                std::string_view value = argv[++i];
+                auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), options.jobs);
+                if (ec != std::errc() || end != value.data() + value.size() || options.jobs < 1 || options.jobs > MaxJobs)
+                {
+                    std::fprintf(stderr, "Job count must be between 1 and %u.\n", MaxJobs);
+                    return false;
+                }
+            }
+            else if (arg == "-r" || arg == "--recursive")
+                options.recursive = true;
+            else if (arg == "-q" || arg == "--quiet")
+                options.quiet = true;
+            else if (!arg.empty() && arg[0] == '-')
+                return false;
+            else
+                options.inputs.push_back(arg);
+        }
+
+        if (options.command == Command::Convert && !options.format)
+        {
+            std::fputs("convert needs an output --format.\n", stderr);
+            return false;
+        }
+
+        if (options.command == Command::Macro && macroFile.empty())
+        {
+            std::fputs("macro needs a --macro file.\n", stderr);
+            return false;
+        }
+
+        return !options.inputs.empty();
+    }
+
+    // Explicitly named files are always processed, files found in
+    // directories only if some codec claims their extension.
+    std::vector<std::string> CollectFiles(const Options &options)
+    {
+        std::vector<std::string> files;
+
+        for (const auto &input : options.inputs)
+        {
+            std::error_code ec;
+            if (!std::filesystem::is_directory(input, ec))
+            {
+                files.push_back(input);
+                continue;
+            }
+
+            auto addEntry = [&files](const std::filesystem::directory_entry &entry) {
+                std::error_code ec;
+                if (entry.is_regular_file(ec) && Codecs::FindByExtension(entry.path().string()))
+                    files.push_back(entry.path().string());
+            };
+
+            if (options.recursive)
+            {
+                for (const auto &entry : std::filesystem::recursive_directory_iterator(input, ec))
+                    addEntry(entry);
+            }
+            else
+            {
+                for (const auto &entry : std::filesystem::directory_iterator(input, ec))
+                    addEntry(entry);
+            }
+        }
+
+        return files;
+    }
+
+    int RunDedupe(const Options &options, const std::vector<std::string> &files, JobSystem &pool)
+    {
+        DedupeIndex index;
+        if (!options.indexFile.empty())
+            index.Load(options.indexFile);
+
+        auto start = std::chrono::steady_clock::now();
+        size_t hashed = index.Refresh(files, pool);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        if (!options.indexFile.empty())
+        {
+            index.Prune();
+            if (!index.Save(options.indexFile))
+                std::fprintf(stderr, "%s: Could not write the index file.\n", options.indexFile.c_str());
+        }
+
+        // The index may hold files from earlier runs, only report the ones
+        // that were asked for.
+        std::unordered_set<std::string> requested(files.begin(), files.end());
+        size_t numGroups = 0, numDuplicates = 0;
+
+        for (const auto &group : index.GetDuplicateGroups())
+        {
+            std::vector<const std::string *> members;
+            for (const auto &fname : group)
+            {
+                if (requested.count(fname))
+                    members.push_back(&fname);
+            }
+
+            if (members.size() < 2)
+                continue;
+
+            ++numGroups;
+            numDuplicates += members.size() - 1;
+            if (options.quiet)
+                continue;
+
+            std::printf("%016llx\n", static_cast<unsigned long long>(index.GetEntries().at(*members[0]).hash));
+            for (auto fname : members)
+                std::printf("  %s\n", fname->c_str());
+        }
+
+        size_t failed = 0;
+        for (const auto &fname : files)
+        {
+            auto it = index.GetEntries().find(fname);
+            if (it == index.GetEntries().end() || !it->second.valid)
+            {
+                ++failed;
+                std::fprintf(stderr, "%s: Could not read palette.\n", fname.c_str());
+            }
+        }
+
+        std::printf(
+            "%zu file(s), %zu failed, %zu hashed in %.3f s, %zu group(s), %zu duplicate(s)\n",
+            files.size(), failed, hashed, seconds, numGroups, numDuplicates
+        );
+
+        return failed ? 1 : 0;
+    }
+
+    std::string GetOutputPath(const Options &options, const std::string &input)
+    {
+        std::filesystem::path path(input);
+
+        std::string ext = options.command == Command::Render ? "ppm" : options.format->GetExtensions();
+        ext = ext.substr(0, ext.find(','));
+        path.replace_extension(ext.empty() ? "pal" : ext);
+
+        if (!options.outputDir.empty())
+            path = std::filesystem::path(options.outputDir) / path.filename();
+
+        return path.string();
+    }
+
+    // Binary PPM; the gaps between the swatches come out black.
+    void RenderSwatches(const Options &options, const Palette &palette, std::string &out)
+    {
+        SwatchGrid grid(options.columns, options.cellSize);
+        size_t numRows = std::max<size_t>(1, grid.GetRowCount(palette.size()));
+
+        static thread_local std::vector<uint8_t> rgba;
+        grid.Rasterize(palette, 0, numRows, rgba);
+
+        char header[64];
+        int headerSize = std::snprintf(header, sizeof(header), "P6\n%d %zu\n255\n", grid.GetWidth(), numRows * grid.GetCellSize());
+
+        out.assign(header, headerSize);
+        out.reserve(headerSize + rgba.size() / 4 * 3);
+        for (size_t i = 0; i < rgba.size(); i += 4)
+            out.append(reinterpret_cast<const char *>(&rgba[i]), 3);
+    }
+
+    void ProcessFile(const Options &options, const std::string &fname, FileResult &result)
+    {
+        TRACE_SCOPE("ProcessFile");
+        io::MappedFile file(fname);
+        if (!file.IsOpen())
+        {
+            result.error = "Could not open file.";
+            return;
+        }
+
+        result.bytesRead = file.size();
+
+        try
+        {
+            auto data = file.GetSpan();
+            auto codec = Codecs::Detect(data, data.size(), fname);
+            if (!codec)
+                throw ("Unrecognized palette format.");
+
+            Palette palette;
+            codec->Decode(palette, data);
+            result.numColors = palette.size();
+
+            if (options.command == Command::Validate)
+                return;
+
+            if (options.command == Command::Macro)
+                options.macro.ApplyTo(palette);
+
+            static thread_local std::string buffer;
+            std::string outPath = fname;
+
+            if (options.command == Command::Render)
+            {
+                outPath = GetOutputPath(options, fname);
+                RenderSwatches(options, palette, buffer);
+
+                // Same for images that did not change since the last run.
+                io::MappedFile existing(outPath);
+                if (existing.IsOpen() && existing.size() == buffer.size() && std::memcmp(existing.GetSpan().data(), buffer.data(), buffer.size()) == 0)
+                    return;
+            }
+            else
+            {
+                if (options.command == Command::Convert)
+                {
+                    codec = options.format;
+                    outPath = GetOutputPath(options, fname);
+                }
+
+                codec->Encode(palette, buffer);
+            }
+
+            // Leave files that are already normalized untouched, so their
+            // modification time does not change.
+            if (outPath == fname && buffer.size() == data.size() && std::memcmp(buffer.data(), data.data(), data.size()) == 0)
+                return;
+
+            file.Close();
+            if (!io::WriteFileAtomic(outPath, buffer))
+                throw ("Could not write the palette file.");
+
+            result.written = true;
+        }
+        catch (const char *e)
+        {
+            result.error = e;
+        }
+        catch (const std::exception &e)
+        {
+            result.error = e.what();
+        }
+    }
+}
+
+static int RunCommand(const Options &options)
+{
+    TRACE_SCOPE("RunCommand");
+
+    if (!options.outputDir.empty())
+    {
+        std::error_code ec;
+        std::filesystem::create_directories(options.outputDir, ec);
+    }
+
+    // The main thread takes part in the work, so -j N needs N - 1 workers.
+    std::unique_ptr<JobSystem> ownPool;
+    if (options.jobs)
+        ownPool = std::make_unique<JobSystem>(options.jobs - 1);
+    auto &pool = ownPool ? *ownPool : JobSystem::Get();
+    unsigned numThreads = pool.GetThreadCount() + 1;
+
+    auto files = CollectFiles(options);
+    if (options.command == Command::Dedupe)
+        return RunDedupe(options, files, pool);
+
+    std::vector<FileResult> results(files.size());
+
+    auto start = std::chrono::steady_clock::now();
+
+    // One job per file; idle workers steal from busy ones, which keeps every
+    // core busy even when file sizes vary a lot.
+    pool.ParallelFor(files.size(), [&](size_t i) {
+        ProcessFile(options, files[i], results[i]);
+    });
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    size_t failed = 0, written = 0, totalBytes = 0;
+    for (size_t i = 0; i < files.size(); ++i)
+    {
+        const auto &result = results[i];
+        totalBytes += result.bytesRead;
+
+        if (!result.error.empty())
+        {
+            ++failed;
+            std::fprintf(stderr, "%s: %s\n", files[i].c_str(), result.error.c_str());
+        }
+        else
+        {
+            written += result.written;
+            if (!options.quiet)
+                std::printf("%s: ok (%zu colors)%s\n", files[i].c_str(), result.numColors, result.written ? ", written" : "");
+        }
+    }
+
+    std::printf(
+        "%zu file(s), %zu failed, %zu written, %.2f MB in %.3f s (%.0f files/s, %.2f MB/s, %u threads)\n",
+        files.size(), failed, written, totalBytes / 1e6, seconds,
+        seconds > 0 ? files.size() / seconds : 0.0,
+        seconds > 0 ? totalBytes / 1e6 / seconds : 0.0,
+        numThreads
+    );
+
+    return failed ? 1 : 0;
+}
+
+int main(int argc, char *argv[])
+{
+    Options options;
+    if (!ParseArguments(argc, argv, options))
+    {
+        PrintUsage();
+        return 2;
+    }
+
+    if (options.traceFile.empty())
+        return RunCommand(options);
+
+    Trace::SetThreadName("Main");
+    Trace::SetEnabled(true);
+    int status = RunCommand(options);
+    Trace::SetEnabled(false);
+
+    if (!Trace::Save(options.traceFile))
+    {
+        std::fprintf(stderr, "%s: Could not write the trace file.\n", options.traceFile.c_str());
+        return status ? status : 1;
+    }
+    return status;
+}
@@ -0,0 +1,121 @@
+#include "codecs.hpp"
+#include "codecs/act.hpp"
+#include "codecs/gba.hpp"
+#include "codecs/gpl.hpp"
+#include "codecs/hex.hpp"
+#include "codecs/jasc.hpp"
+#include "codecs/riff.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <string_view>
+
+bool Codec::HasExtension(const std::string &fname) const
+{
+    std::string ext = std::filesystem::path(fname).extension().string();
+    if (ext.size() < 2)
+        return false;
+
+    ext.erase(0, 1);
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return std::tolower(c); });
+
+    std::string_view list = GetExtensions();
+    while (!list.empty())
+    {
+        size_t comma = list.find(',');
+        if (list.substr(0, comma) == ext)
+            return true;
+        if (comma == std::string_view::npos)
+            break;
+        list.remove_prefix(comma + 1);
+    }
+
+    return false;
+}
+
+namespace Codecs
+{
+    const std::vector<const Codec *> &GetAll()
+    {
+        static const Jasc jasc;
+        static const Jasc jascStrict(true);
+        static const RiffPal riff;
+        static const Gpl gpl;
+        static const HexList hex;
+        static const Act act;
+        static const Bgr555 gba;
+
+        // Weak matches are tried in this order, so the most permissive
+        // formats come last.
+        static const std::vector<const Codec *> codecs = { &jasc, &riff, &gpl, &hex, &act, &gba, &jascStrict };
+        return codecs;
+    }
+
+    const Codec *FindByName(const std::string &name)
+    {
+        for (auto codec : GetAll())
+        {
+            if (name == codec->GetName())
+                return codec;
+        }
+        return nullptr;
+    }
+
+    const Codec *FindByExtension(const std::string &fname)
+    {
+        for (auto codec : GetAll())
+        {
+            if (codec->HasExtension(fname))
+                return codec;
+        }
+        return nullptr;
+    }
+
+    const Codec *Detect(std::span<const char> header, size_t fileSize, const std::string &fname)
+    {
+        header = header.first(std::min(header.size(), SniffSize));
+
+        const Codec *best = nullptr;
+        int bestScore = 0;
+
+        for (auto codec : GetAll())
+        {
+            auto match = codec->Sniff(header, fileSize);
+            if (match == Codec::Match::None)
+                continue;
+
+            bool extension = !fname.empty() && codec->HasExtension(fname);
+            if (match == Codec::Match::Weak && codec->NeedsExtension() && !extension)
+                continue;
+
+            // A magic match always wins, the extension only breaks ties.
+            int score = static_cast<int>(match) * 2 + (extension ? 1 : 0);
+            if (score > bestScore)
+            {
+                best = codec;
+                bestScore = score;
+            }
+        }
+
+        if (!best && !fname.empty())
+            best = FindByExtension(fname);
+
+        return best;
+    }
+
+    const Codec *DetectFile(const std::string &fname)
+    {
+        std::error_code ec;
+        size_t fileSize = std::filesystem::file_size(fname, ec);
+        if (ec)
+            return nullptr;
+
+        char header[SniffSize];
+        std::ifstream stream(fname, std::ios::binary);
+        stream.read(header, sizeof(header));
+
+        return Detect({ header, static_cast<size_t>(stream.gcount()) }, fileSize, fname);
+    }
+}
@@ -0,0 +1,68 @@
+#include "codecs/act.hpp"
+
+namespace
+{
+    constexpr size_t sColorTableSize = 256 * 3;
+}
+
+namespace Codecs
+{
+    Codec::Match Act::Sniff(std::span<const char>, size_t fileSize) const
+    {
+        // Adobe color tables have no magic, only a fixed size with an
+        // optional count/transparency trailer.
+        return fileSize == sColorTableSize || fileSize == sColorTableSize + 4 ? Match::Weak : Match::None;
+    }
+
+    void Act::Decode(Palette &palette, std::span<const char> buffer) const
+    {
+        if (buffer.size() != sColorTableSize && buffer.size() != sColorTableSize + 4)
+            throw ("Invalid ACT palette size.");
+
+        size_t num_colors = 256;
+        if (buffer.size() == sColorTableSize + 4)
+        {
+            const auto *trailer = reinterpret_cast<const uint8_t *>(buffer.data() + sColorTableSize);
+            size_t count = (trailer[0] << 8) | trailer[1];
+            if (count >= 1 && count <= 256)
+                num_colors = count;
+        }
+
+        Palette new_colors(num_colors);
+        const auto *in = reinterpret_cast<const uint8_t *>(buffer.data());
+
+        for (size_t i = 0; i < new_colors.GetChunkCount(); ++i)
+        {
+            for (auto &color : new_colors.GetChunk(i))
+            {
+                color = { in[0], in[1], in[2] };
+                in += 3;
+            }
+        }
+
+        palette = std::move(new_colors);
+    }
+
+    void Act::Encode(const Palette &palette, std::string &buffer) const
+    {
+        if (palette.size() > 256)
+            throw ("Unsupported number of colors. (ACT palettes allow at most 256 colors)");
+
+        buffer.assign(sColorTableSize + 4, '\0');
+        char *out = buffer.data();
+
+        for (size_t i = 0; i < palette.size(); ++i)
+        {
+            const auto &color = palette[i];
+            *out++ = static_cast<char>(color.r);
+            *out++ = static_cast<char>(color.g);
+            *out++ = static_cast<char>(color.b);
+        }
+
+        // Color count followed by "no transparent index".
+        buffer[sColorTableSize + 0] = static_cast<char>(palette.size() >> 8);
+        buffer[sColorTableSize + 1] = static_cast<char>(palette.size());
+        buffer[sColorTableSize + 2] = static_cast<char>(0xFF);
+        buffer[sColorTableSize + 3] = static_cast<char>(0xFF);
+    }
+}
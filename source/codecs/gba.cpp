@@ -0,0 +1,76 @@
+#include "codecs/gba.hpp"
+#include "bgr555.hpp"
+
+#include <array>
+#include <bit>
+#include <cstring>
+
+namespace Codecs
+{
+    Codec::Match Bgr555::Sniff(std::span<const char> header, size_t fileSize) const
+    {
+        if (fileSize == 0 || fileSize % 2 != 0 || fileSize / 2 > Palette::MaxColors)
+            return Match::None;
+
+        // There is no magic, but the unused top bit is almost always clear.
+        for (size_t i = 1; i < header.size(); i += 2)
+        {
+            if (header[i] & 0x80)
+                return Match::None;
+        }
+
+        return Match::Weak;
+    }
+
+    void Bgr555::Decode(Palette &palette, std::span<const char> buffer) const
+    {
+        if (buffer.empty() || buffer.size() % 2 != 0)
+            throw ("Invalid BGR555 palette size.");
+
+        if (buffer.size() / 2 > Palette::MaxColors)
+            throw ("Unsupported number of colors. (Color count must be between 1 and 16777216)");
+
+        Palette new_colors(buffer.size() / 2);
+        std::array<uint16_t, Palette::ChunkSize> words;
+        const char *in = buffer.data();
+
+        for (size_t chunk = 0; chunk < new_colors.GetChunkCount(); ++chunk)
+        {
+            auto colors = new_colors.GetChunk(chunk);
+            std::memcpy(words.data(), in, colors.size() * 2);
+            in += colors.size() * 2;
+
+            if constexpr (std::endian::native == std::endian::big)
+            {
+                for (auto &word : words)
+                    word = static_cast<uint16_t>((word >> 8) | (word << 8));
+            }
+
+            bgr555::Unpack({ words.data(), colors.size() }, colors.data());
+        }
+
+        palette = std::move(new_colors);
+    }
+
+    void Bgr555::Encode(const Palette &palette, std::string &buffer) const
+    {
+        buffer.resize(palette.size() * 2);
+        std::array<uint16_t, Palette::ChunkSize> words;
+        char *out = buffer.data();
+
+        for (size_t chunk = 0; chunk < palette.GetChunkCount(); ++chunk)
+        {
+            auto colors = palette.GetChunk(chunk);
+            bgr555::Pack(colors, words.data());
+
+            if constexpr (std::endian::native == std::endian::big)
+            {
+                for (auto &word : words)
+                    word = static_cast<uint16_t>((word >> 8) | (word << 8));
+            }
+
+            std::memcpy(out, words.data(), colors.size() * 2);
+            out += colors.size() * 2;
+        }
+    }
+}
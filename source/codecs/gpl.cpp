@@ -0,0 +1,84 @@
+#include "codecs/gpl.hpp"
+#include "text_scanner.hpp"
+
+#include <charconv>
+#include <cstring>
+#include <string_view>
+
+static constexpr char sText_GIMP_Palette[] = "GIMP Palette";
+
+namespace Codecs
+{
+    Codec::Match Gpl::Sniff(std::span<const char> header, size_t) const
+    {
+        std::string_view text(header.data(), header.size());
+        return text.starts_with(sText_GIMP_Palette) ? Match::Strong : Match::None;
+    }
+
+    void Gpl::Decode(Palette &palette, std::span<const char> buffer) const
+    {
+        TextScanner scanner(buffer);
+
+        if (!scanner.NextLine().starts_with(sText_GIMP_Palette))
+            throw ("Invalid GIMP palette signature.");
+
+        Palette new_colors;
+
+        while (!scanner.AtEnd())
+        {
+            auto line = scanner.NextLine();
+            while (!line.empty() && TextScanner::IsWhitespace(line.front()))
+                line.remove_prefix(1);
+
+            if (line.empty() || line.front() == '#' || line.starts_with("Name:") || line.starts_with("Columns:"))
+                continue;
+
+            // Anything after the components is the color name.
+            TextScanner components({ line.data(), line.size() });
+            long r, g, b;
+
+            if (!components.NextInt(r) || !components.NextInt(g) || !components.NextInt(b))
+                throw ("Error parsing color components.");
+
+            if (r < 0 || g < 0 || b < 0 || r > 255 || g > 255 || b > 255)
+                throw ("Color component value must be between 0 and 255.");
+
+            if (new_colors.size() == Palette::MaxColors)
+                throw ("Unsupported number of colors. (Color count must be between 1 and 16777216)");
+
+            new_colors.push_back({ static_cast<uint8_t>(r), static_cast<uint8_t>(g), static_cast<uint8_t>(b) });
+        }
+
+        if (new_colors.size() == 0)
+            throw ("Unsupported number of colors. (Color count must be between 1 and 16777216)");
+
+        palette = std::move(new_colors);
+    }
+
+    void Gpl::Encode(const Palette &palette, std::string &buffer) const
+    {
+        static constexpr char sHeader[] = "GIMP Palette\nName: Palette\nColumns: 16\n#\n";
+
+        buffer.resize(sizeof(sHeader) + palette.size() * 12);
+        char *out = buffer.data();
+        char *end = out + buffer.size();
+
+        std::memcpy(out, sHeader, sizeof(sHeader) - 1);
+        out += sizeof(sHeader) - 1;
+
+        for (size_t i = 0; i < palette.GetChunkCount(); ++i)
+        {
+            for (auto &color : palette.GetChunk(i))
+            {
+                out = std::to_chars(out, end, color.r).ptr;
+                *out++ = ' ';
+                out = std::to_chars(out, end, color.g).ptr;
+                *out++ = ' ';
+                out = std::to_chars(out, end, color.b).ptr;
+                *out++ = '\n';
+            }
+        }
+
+        buffer.resize(out - buffer.data());
+    }
+}
@@ -0,0 +1,120 @@
+#include "codecs/hex.hpp"
+#include "text_scanner.hpp"
+
+#include <string_view>
+
+namespace
+{
+    // Accepts "RRGGBB", "#RRGGBB", "0xRRGGBB" and Paint.NET style "AARRGGBB".
+    std::string_view StripPrefix(std::string_view token)
+    {
+        if (token.starts_with('#'))
+            token.remove_prefix(1);
+        else if (token.starts_with("0x") || token.starts_with("0X"))
+            token.remove_prefix(2);
+        return token;
+    }
+
+    bool IsHex(std::string_view digits)
+    {
+        for (char c : digits)
+        {
+            if (TextScanner::HexValue(c) < 0)
+                return false;
+        }
+        return !digits.empty();
+    }
+
+    bool IsCommentLine(std::string_view line)
+    {
+        while (!line.empty() && TextScanner::IsWhitespace(line.front()))
+            line.remove_prefix(1);
+        return line.starts_with(';') || line.starts_with("//");
+    }
+}
+
+namespace Codecs
+{
+    Codec::Match HexList::Sniff(std::span<const char> header, size_t) const
+    {
+        TextScanner scanner(header);
+
+        while (!scanner.AtEnd())
+        {
+            auto line = scanner.NextLine();
+            if (IsCommentLine(line))
+                continue;
+
+            TextScanner tokens({ line.data(), line.size() });
+            auto digits = StripPrefix(tokens.NextToken());
+            if (digits.empty())
+                continue;
+
+            // The header may cut the first color short.
+            bool truncated = scanner.AtEnd() && digits.data() + digits.size() == header.data() + header.size();
+            bool complete = digits.size() == 6 || digits.size() == 8;
+            return IsHex(digits) && (complete || (truncated && digits.size() < 8)) ? Match::Weak : Match::None;
+        }
+
+        return Match::None;
+    }
+
+    void HexList::Decode(Palette &palette, std::span<const char> buffer) const
+    {
+        TextScanner scanner(buffer);
+        Palette new_colors;
+
+        while (!scanner.AtEnd())
+        {
+            auto line = scanner.NextLine();
+            if (IsCommentLine(line))
+                continue;
+
+            TextScanner tokens({ line.data(), line.size() });
+            for (auto token = tokens.NextToken(); !token.empty(); token = tokens.NextToken())
+            {
+                auto digits = StripPrefix(token);
+                if ((digits.size() != 6 && digits.size() != 8) || !IsHex(digits))
+                    throw ("Invalid hex color.");
+
+                // Drop the alpha byte of AARRGGBB.
+                digits.remove_prefix(digits.size() - 6);
+
+                auto byte = [&digits](size_t i) {
+                    return static_cast<uint8_t>(TextScanner::HexValue(digits[i * 2]) << 4 | TextScanner::HexValue(digits[i * 2 + 1]));
+                };
+
+                if (new_colors.size() == Palette::MaxColors)
+                    throw ("Unsupported number of colors. (Color count must be between 1 and 16777216)");
+
+                new_colors.push_back({ byte(0), byte(1), byte(2) });
+            }
+        }
+
+        if (new_colors.size() == 0)
+            throw ("Unsupported number of colors. (Color count must be between 1 and 16777216)");
+
+        palette = std::move(new_colors);
+    }
+
+    void HexList::Encode(const Palette &palette, std::string &buffer) const
+    {
+        static constexpr char sDigits[] = "0123456789abcdef";
+
+        buffer.resize(palette.size() * 7);
+        char *out = buffer.data();
+
+        for (size_t i = 0; i < palette.GetChunkCount(); ++i)
+        {
+            for (auto &color : palette.GetChunk(i))
+            {
+                for (size_t c = 0; c < 3; ++c)
+                {
+                    *out++ = sDigits[color[c] >> 4];
+                    *out++ = sDigits[color[c] & 0xF];
+                }
+                *out++ = '\n';
+            }
+        }
+    }
+}
@@ -0,0 +1,138 @@
+#include "codecs/jasc.hpp"
+#include "text_scanner.hpp"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstring>
+#include <string_view>
+
+static constexpr char sText_JASC_PAL[] = "JASC-PAL";
+static constexpr char sText_PAL_0100[] = "0100";
+
+namespace
+{
+    struct ComponentText
+    {
+        char text[4];
+        uint8_t length;
+    };
+
+    // "0 ".."255 " with the trailing separator, so a color is three copies.
+    constexpr auto sComponentTexts = []() {
+        std::array<ComponentText, 256> texts{};
+        for (int i = 0; i < 256; ++i)
+        {
+            auto &t = texts[i];
+            if (i >= 100) t.text[t.length++] = '0' + i / 100;
+            if (i >= 10) t.text[t.length++] = '0' + i / 10 % 10;
+            t.text[t.length++] = '0' + i % 10;
+            t.text[t.length++] = ' ';
+        }
+        return texts;
+    }();
+}
+
+namespace Codecs
+{
+    Codec::Match Jasc::Sniff(std::span<const char> header, size_t) const
+    {
+        if (m_Strict)
+            return Match::None;
+
+        std::string_view text(header.data(), header.size());
+        text.remove_prefix(std::min(text.size(), text.find_first_not_of(" \t\r\n")));
+        return text.starts_with(sText_JASC_PAL) ? Match::Strong : Match::None;
+    }
+
+    void Jasc::Decode(Palette &palette, std::span<const char> buffer) const
+    {
+        TextScanner scanner(buffer);
+        long num_colors, r, g, b;
+
+        if (scanner.NextToken() != sText_JASC_PAL) 
+            throw ("Invalid JASC-PAL signature.");
+
+        if (scanner.NextToken() != sText_PAL_0100) 
+            throw ("Unsupported JASC-PAL version.");
+
+        if (!scanner.NextInt(num_colors))
+            throw ("Could not parse number of colors.");
+
+        size_t maxColors = m_Strict ? Palette::MaxJascColors : Palette::MaxColors;
+        if (num_colors < 1 || static_cast<size_t>(num_colors) > maxColors)
+        {
+            if (m_Strict)
+                throw ("Unsupported number of colors. (Color count must be between 1 and 256)");
+            throw ("Unsupported number of colors. (Color count must be between 1 and 16777216)");
+        }
+
+        // Every color takes at least "0 0 0" and a separator, so a header
+        // claiming more than the file can hold fails before allocating.
+        if (static_cast<size_t>(num_colors) > (scanner.Remaining() + 1) / 6)
+            throw ("Error parsing color components.");
+
+        Palette new_colors(num_colors);
+
+        for (size_t chunk = 0; chunk < new_colors.GetChunkCount(); ++chunk)
+        {
+            for (auto &color : new_colors.GetChunk(chunk))
+            {
+                if (!scanner.NextInt(r) || !scanner.NextInt(g) || !scanner.NextInt(b))
+                    throw ("Error parsing color components.");
+
+                if (r < 0 || g < 0 || b < 0 || r > 255 || g > 255 || b > 255)
+                    throw ("Color component value must be between 0 and 255.");
+
+                color = { 
+                    static_cast<uint8_t>(r), 
+                    static_cast<uint8_t>(g), 
+                    static_cast<uint8_t>(b) 
+                };
+            }
+        }
+
+        palette = std::move(new_colors);
+    }
+
+    void Jasc::Encode(const Palette &palette, std::string &buffer) const
+    {
+        if (m_Strict && palette.size() > Palette::MaxJascColors)
+            throw ("Unsupported number of colors. (Strict JASC-PAL allows at most 256 colors)");
+
+        // Worst case is "255 255 255\r\n" per color plus the header.
+        buffer.resize(32 + palette.size() * 13);
+        char *out = buffer.data();
+
+        auto append = [&out](const char *text, size_t length) {
+            std::memcpy(out, text, length);
+            out += length;
+        };
+
+        append(sText_JASC_PAL, sizeof(sText_JASC_PAL) - 1);
+        append("\r\n", 2);
+        append(sText_PAL_0100, sizeof(sText_PAL_0100) - 1);
+        append("\r\n", 2);
+        out = std::to_chars(out, buffer.data() + buffer.size(), palette.size()).ptr;
+        append("\r\n", 2);
+
+        for (size_t chunk = 0; chunk < palette.GetChunkCount(); ++chunk)
+        {
+            for (auto &color : palette.GetChunk(chunk))
+            {
+                for (size_t i = 0; i < 3; ++i)
+                {
+                    const auto &t = sComponentTexts[color[i]];
+                    std::memcpy(out, t.text, 4);
+                    out += t.length;
+                }
+
+                // Replace the last separator with the line break.
+                --out;
+                append("\r\n", 2);
+            }
+        }
+
+        buffer.resize(out - buffer.data());
+    }
+}
@@ -0,0 +1,117 @@
+#include "codecs/riff.hpp"
+
+#include <cstring>
+#include <string_view>
+
+namespace
+{
+    uint32_t ReadU32(const char *p)
+    {
+        const auto *b = reinterpret_cast<const uint8_t *>(p);
+        return b[0] | (b[1] << 8) | (b[2] << 16) | (static_cast<uint32_t>(b[3]) << 24);
+    }
+
+    uint16_t ReadU16(const char *p)
+    {
+        const auto *b = reinterpret_cast<const uint8_t *>(p);
+        return static_cast<uint16_t>(b[0] | (b[1] << 8));
+    }
+
+    char *WriteU32(char *p, uint32_t v)
+    {
+        for (int i = 0; i < 4; ++i)
+            *p++ = static_cast<char>(v >> (i * 8));
+        return p;
+    }
+
+    char *WriteU16(char *p, uint16_t v)
+    {
+        *p++ = static_cast<char>(v);
+        *p++ = static_cast<char>(v >> 8);
+        return p;
+    }
+}
+
+namespace Codecs
+{
+    Codec::Match RiffPal::Sniff(std::span<const char> header, size_t) const
+    {
+        if (header.size() < 12)
+            return Match::None;
+
+        std::string_view text(header.data(), header.size());
+        return text.starts_with("RIFF") && text.substr(8, 4) == "PAL " ? Match::Strong : Match::None;
+    }
+
+    void RiffPal::Decode(Palette &palette, std::span<const char> buffer) const
+    {
+        if (buffer.size() < 12 || std::memcmp(buffer.data(), "RIFF", 4) != 0 || std::memcmp(buffer.data() + 8, "PAL ", 4) != 0)
+            throw ("Invalid RIFF palette signature.");
+
+        size_t offset = 12;
+        while (offset + 8 <= buffer.size())
+        {
+            const char *chunk = buffer.data() + offset;
+            size_t chunkSize = ReadU32(chunk + 4);
+
+            if (std::memcmp(chunk, "data", 4) != 0)
+            {
+                // Chunks are padded to an even size.
+                offset += 8 + chunkSize + (chunkSize & 1);
+                continue;
+            }
+
+            if (chunkSize < 4 || offset + 8 + chunkSize > buffer.size())
+                throw ("Truncated RIFF palette data.");
+
+            size_t num_colors = ReadU16(chunk + 10);
+            if (num_colors < 1 || 4 + num_colors * 4 > chunkSize)
+                throw ("Unsupported number of colors in RIFF palette.");
+
+            Palette new_colors(num_colors);
+            const char *entry = chunk + 12;
+
+            for (size_t i = 0; i < new_colors.GetChunkCount(); ++i)
+            {
+                for (auto &color : new_colors.GetChunk(i))
+                {
+                    color = { static_cast<uint8_t>(entry[0]), static_cast<uint8_t>(entry[1]), static_cast<uint8_t>(entry[2]) };
+                    entry += 4;
+                }
+            }
+
+            palette = std::move(new_colors);
+            return;
+        }
+
+        throw ("RIFF palette has no data chunk.");
+    }
+
+    void RiffPal::Encode(const Palette &palette, std::string &buffer) const
+    {
+        if (palette.size() > 0xFFFF)
+            throw ("Unsupported number of colors. (RIFF palettes allow at most 65535 colors)");
+
+        uint32_t dataSize = 4 + static_cast<uint32_t>(palette.size()) * 4;
+        buffer.resize(20 + dataSize);
+        char *out = buffer.data();
+
+        std::memcpy(out, "RIFF", 4);
+        out = WriteU32(out + 4, 12 + dataSize);
+        std::memcpy(out, "PAL data", 8);
+        out = WriteU32(out + 8, dataSize);
+        out = WriteU16(out, 0x0300);
+        out = WriteU16(out, static_cast<uint16_t>(palette.size()));
+
+        for (size_t i = 0; i < palette.GetChunkCount(); ++i)
+        {
+            for (auto &color : palette.GetChunk(i))
+            {
+                *out++ = static_cast<char>(color.r);
+                *out++ = static_cast<char>(color.g);
+                *out++ = static_cast<char>(color.b);
+                *out++ = 0;
+            }
+        }
+    }
+}
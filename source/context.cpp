@@ -1,29 +1,551 @@
 #include "context.hpp"
-#include <fstream>
+#include "codecs.hpp"
+#include "fs.hpp"
+#include "io.hpp"
+#include "trace.hpp"
+#include <algorithm>
+#include <string_view>
+#include <cstring>
+#include <GLFW/glfw3.h>
 
 std::vector<std::unique_ptr<Context>> Context::s_OpenContexts;
 Context *Context::s_CurrentContext = 0;
+bool Context::s_JournalEnabled = false;
+bool Context::s_SessionHistory = false;
+size_t Context::s_MemoryBudget = 0;
+uint64_t Context::s_UseCounter = 0;
 
-Context::Context(const std::string &fname) : loadedFile(fname), isDirty(false), palette(1)
+static constexpr char sText_SessionMagic[8] = { 'P', 'A', 'L', 'S', 'E', 'S', 'N', '2' };
+
+namespace
+{
+    constexpr size_t SessionHeaderSize = 40;
+
+    // Session flags
+    constexpr uint64_t SessionHasHistory = 1;
+    // Tab flags
+    constexpr uint64_t TabLoading = 1;
+    constexpr uint64_t TabSaved = 2;
+
+    // Little endian, like the journal.
+    void AppendU64(std::string &out, uint64_t v)
+    {
+        for (int i = 0; i < 8; ++i)
+            out += static_cast<char>(v >> (8 * i));
+    }
+
+    uint64_t GetU64(const char *in)
+    {
+        uint64_t v = 0;
+        for (int i = 0; i < 8; ++i)
+            v |= static_cast<uint64_t>(static_cast<uint8_t>(in[i])) << (8 * i);
+        return v;
+    }
+
+    uint64_t HashBytes(const char *data, size_t size)
+    {
+        uint64_t hash = 0xCBF29CE484222325ULL;
+        for (size_t i = 0; i < size; ++i)
+            hash = (hash ^ static_cast<uint8_t>(data[i])) * 0x100000001B3ULL;
+        return hash;
+    }
+
+    struct SessionTab
+    {
+        uint64_t flags = 0, savedHash = 0;
+        std::string_view path, codec;
+        std::span<const char> palette, history;
+    };
+
+    // Splits the body into tabs without copying anything out of the map.
+    bool ReadSessionTabs(const char *data, size_t size, size_t count, std::vector<SessionTab> &tabs)
+    {
+        size_t pos = 0;
+        auto read = [&](std::span<const char> &out) {
+            if (size - pos < 8 || GetU64(data + pos) > size - pos - 8)
+                return false;
+            out = { data + pos + 8, static_cast<size_t>(GetU64(data + pos)) };
+            pos += 8 + out.size();
+            return true;
+        };
+
+        tabs.resize(count);
+        for (auto &tab : tabs)
+        {
+            std::span<const char> path, codec;
+            if (size - pos < 16)
+                return false;
+            tab.flags = GetU64(data + pos);
+            tab.savedHash = GetU64(data + pos + 8);
+            pos += 16;
+            if (!read(path) || !read(codec) || !read(tab.palette) || !read(tab.history))
+                return false;
+            tab.path = { path.data(), path.size() };
+            tab.codec = { codec.data(), codec.size() };
+        }
+        return pos == size;
+    }
+}
+
+Context::Context() : palette(1), actionRegister(palette), journal(palette, actionRegister)
+{
+    actionRegister.SetObserver([this](const HistoryEvent &event) {
+        if (journal.IsOpen())
+            journal.Append(event);
+        if (recordingMacro)
+            recordingMacro->Observe(event);
+    });
+    savedHash = actionRegister.GetHash();
+}
+
+Context::~Context()
 {
-    palette.LoadFromFile(fname);
+    if (m_SpilledHistory)
+        std::fclose(m_SpilledHistory);
 }
 
 Context &Context::CreateNewContext()
 {
     s_OpenContexts.push_back(std::make_unique<Context>());
     s_CurrentContext = s_OpenContexts.back().get();
+    s_CurrentContext->m_LastUsed = ++s_UseCounter;
     return *s_CurrentContext;
 }
 
-Context &Context::CreateNewContext(const std::string &fname)
+void Context::SetContext(size_t idx)
 {
-    s_OpenContexts.push_back(std::make_unique<Context>(fname));
-    s_CurrentContext = s_OpenContexts.back().get();
-    return *s_CurrentContext;
+    auto *ctx = s_OpenContexts[idx].get();
+    ctx->m_LastUsed = ++s_UseCounter;
+    if (ctx == s_CurrentContext)
+        return;
+
+    s_CurrentContext = ctx;
+    ctx->Expand();
+    EnforceMemoryBudget();
+}
+
+Context &Context::DuplicateContext(const Context &source)
+{
+    auto &ctx = CreateNewContext();
+    ctx.SetPalette(source.palette);
+    ctx.savedHash.reset();
+    return ctx;
+}
+
+Context &Context::OpenContext(const std::string &fname)
+{
+    auto &ctx = CreateNewContext();
+    ctx.loadedFile = fname;
+
+    ctx.m_Loading = JobBatch<LoadResult>::Run(JobSystem::Get(), 1, [fname](size_t, LoadResult &result) {
+        io::MappedFile file(fname);
+        if (!file.IsOpen())
+        {
+            result.error = "Could not open file.";
+        }
+        else
+        {
+            try
+            {
+                auto data = file.GetSpan();
+                result.codec = Codecs::Detect(data, data.size(), fname);
+                result.palette.LoadFromBuffer(data, result.codec);
+            }
+            catch (const char *e)
+            {
+                result.error = e;
+            }
+            catch (const std::exception &e)
+            {
+                result.error = e.what();
+            }
+        }
+    }, glfwPostEmptyEvent); // Wakes the main loop in case it is waiting for input.
+
+    return ctx;
+}
+
+std::vector<std::string> Context::UpdateLoadingContexts()
+{
+    TRACE_SCOPE("Context::UpdateLoadingContexts");
+    std::vector<std::string> errors;
+    bool loaded = false;
+
+    for (size_t i = 0; i < s_OpenContexts.size();)
+    {
+        auto &ctx = *s_OpenContexts[i];
+        if (!ctx.IsLoading() || !ctx.m_Loading->IsDone())
+        {
+            ++i;
+            continue;
+        }
+
+        auto &result = ctx.m_Loading->GetResults()[0];
+        if (!result.error.empty())
+        {
+            errors.push_back(fs::GetFilename(ctx.loadedFile) + ": " + result.error);
+            RemoveContext(i);
+            continue;
+        }
+
+        ctx.palette = std::move(result.palette);
+        ctx.codec = result.codec;
+        ctx.actionRegister.Rehash();
+        ctx.savedHash = ctx.actionRegister.GetHash();
+        ctx.m_Loading.reset();
+
+        // A file that is already open shares the colors of that tab.
+        for (auto &other : s_OpenContexts)
+        {
+            if (other.get() != &ctx && !other->IsLoading() && !other->IsCompacted() && other->loadedFile == ctx.loadedFile && other->palette == ctx.palette)
+            {
+                ctx.palette = other->palette;
+                break;
+            }
+        }
+
+        if (s_JournalEnabled)
+        {
+            Journal::Restore(ctx.loadedFile, *ctx.savedHash, ctx.palette, ctx.actionRegister);
+            ctx.journal.Open(ctx.loadedFile, *ctx.savedHash);
+        }
+        loaded = true;
+        ++i;
+    }
+
+    if (loaded)
+        EnforceMemoryBudget();
+    return errors;
+}
+
+void Context::SetPalette(const Palette &colors)
+{
+    palette = colors;
+    actionRegister.Rehash();
+}
+
+void Context::MarkSaved()
+{
+    savedHash = actionRegister.GetHash();
+
+    if (!s_JournalEnabled)
+        return;
+
+    if (journal.IsOpen() && journal.GetPaletteFile() == loadedFile)
+        journal.MarkSaved(*savedHash);
+    else
+        journal.Open(loadedFile, *savedHash);
+}
+
+void Context::SetJournalEnabled(bool enabled)
+{
+    s_JournalEnabled = enabled;
+
+    for (auto &ctx : s_OpenContexts)
+    {
+        // Unsaved tabs are picked up on their next save, since the colors
+        // on disk are not known here.
+        if (!enabled)
+            ctx->journal.Close();
+        else if (!ctx->IsLoading() && !ctx->loadedFile.empty() && !ctx->IsDirty())
+        {
+            // The checkpoint needs the colors and history in memory.
+            ctx->Expand();
+            ctx->journal.Open(ctx->loadedFile, *ctx->savedHash);
+        }
+    }
 }
 
 void Context::RemoveContext(size_t i)
 {
+    bool wasCurrent = s_OpenContexts[i].get() == s_CurrentContext;
     s_OpenContexts.erase(s_OpenContexts.begin() + i);
+
+    // The tab bar picks the current context again next frame, until then
+    // it must not point at the removed one.
+    if (wasCurrent)
+        s_CurrentContext = s_OpenContexts.empty() ? nullptr : s_OpenContexts[std::min(i, s_OpenContexts.size() - 1)].get();
+    if (s_CurrentContext)
+        s_CurrentContext->Expand();
+}
+
+void Context::RemoveContext(const Context *ctx)
+{
+    for (size_t i = 0; i < s_OpenContexts.size(); ++i)
+    {
+        if (s_OpenContexts[i].get() == ctx)
+        {
+            RemoveContext(i);
+            return;
+        }
+    }
+}
+
+Context::MemoryUsage Context::GetMemoryUsage() const
+{
+    MemoryUsage usage;
+    if (m_IsCompacted)
+    {
+        usage.palette = m_CompressedPalette.capacity();
+        usage.spilled = m_SpilledSize;
+    }
+    else
+    {
+        usage.palette = palette.GetMemoryUsage();
+        usage.history = actionRegister.GetMemoryUsage();
+    }
+    return usage;
+}
+
+bool Context::Compact()
+{
+    TRACE_SCOPE("Context::Compact");
+    if (m_IsCompacted || IsLoading() || actionRegister.InTransaction())
+        return false;
+
+    std::string history;
+    Journal::SaveHistory(history, actionRegister.GetState());
+
+    std::FILE *file = std::tmpfile();
+    if (!file)
+        return false;
+    if (std::fwrite(history.data(), 1, history.size(), file) != history.size() || std::fflush(file) != 0)
+    {
+        std::fclose(file);
+        return false;
+    }
+
+    m_CompactedHash = actionRegister.GetHash();
+    palette.Compress(m_CompressedPalette);
+    m_CompressedPalette.shrink_to_fit();
+    m_SpilledHistory = file;
+    m_SpilledSize = history.size();
+
+    palette = Palette();
+    actionRegister.SetState({});
+    m_IsCompacted = true;
+    return true;
+}
+
+void Context::Expand()
+{
+    TRACE_SCOPE("Context::Expand");
+    if (!m_IsCompacted)
+        return;
+
+    m_IsCompacted = false;
+    palette.Decompress(m_CompressedPalette);
+    std::string().swap(m_CompressedPalette);
+
+    // Should the temporary file fail, the colors are still right and only
+    // the history is lost.
+    std::string history;
+    ActionRegister::State state;
+    if (!ReadSpilledHistory(history) || !Journal::LoadHistory(history, state))
+        state = {};
+
+    std::fclose(m_SpilledHistory);
+    m_SpilledHistory = nullptr;
+    m_SpilledSize = 0;
+
+    actionRegister.SetState(std::move(state));
+}
+
+bool Context::ReadSpilledHistory(std::string &out) const
+{
+    out.resize(m_SpilledSize);
+    std::rewind(m_SpilledHistory);
+    return std::fread(out.data(), 1, out.size(), m_SpilledHistory) == out.size();
+}
+
+bool Context::SaveSession(const std::string &fname)
+{
+    TRACE_SCOPE("Context::SaveSession");
+    // Tabs are encoded in parallel and joined in order afterwards.
+    std::vector<std::string> tabs(s_OpenContexts.size());
+    JobSystem::Get().ParallelFor(tabs.size(), [&tabs](size_t i) {
+        const auto &ctx = *s_OpenContexts[i];
+        auto &out = tabs[i];
+
+        std::string palette, history;
+        if (ctx.m_IsCompacted)
+        {
+            palette = ctx.m_CompressedPalette;
+            if (s_SessionHistory && !ctx.ReadSpilledHistory(history))
+                history.clear();
+        }
+        else if (!ctx.IsLoading())
+        {
+            ctx.palette.Compress(palette);
+            if (s_SessionHistory)
+                Journal::SaveHistory(history, ctx.actionRegister.GetState());
+        }
+
+        AppendU64(out, (ctx.IsLoading() ? TabLoading : 0) | (ctx.savedHash ? TabSaved : 0));
+        AppendU64(out, ctx.savedHash.value_or(0));
+        AppendU64(out, ctx.loadedFile.size());
+        out += ctx.loadedFile;
+        std::string_view codec = ctx.codec ? ctx.codec->GetName() : "";
+        AppendU64(out, codec.size());
+        out += codec;
+        AppendU64(out, palette.size());
+        out += palette;
+        AppendU64(out, history.size());
+        out += history;
+    });
+
+    size_t current = 0;
+    for (size_t i = 0; i < s_OpenContexts.size(); ++i)
+    {
+        if (s_OpenContexts[i].get() == s_CurrentContext)
+            current = i;
+    }
+
+    std::string buffer(SessionHeaderSize, '\0');
+    for (auto &tab : tabs)
+    {
+        buffer += tab;
+        std::string().swap(tab);
+    }
+
+    std::string header(sText_SessionMagic, sizeof(sText_SessionMagic));
+    AppendU64(header, s_SessionHistory ? SessionHasHistory : 0);
+    AppendU64(header, tabs.size());
+    AppendU64(header, current);
+    AppendU64(header, HashBytes(buffer.data() + SessionHeaderSize, buffer.size() - SessionHeaderSize));
+    buffer.replace(0, SessionHeaderSize, header);
+
+    return io::WriteFileAtomic(fname, buffer);
+}
+
+bool Context::RestoreSession(const std::string &fname)
+{
+    TRACE_SCOPE("Context::RestoreSession");
+    io::MappedFile file(fname);
+    if (!file.IsOpen() || file.size() < SessionHeaderSize || std::memcmp(file.data(), sText_SessionMagic, sizeof(sText_SessionMagic)) != 0)
+        return false;
+
+    const char *data = file.data();
+    const char *body = data + SessionHeaderSize;
+    size_t bodySize = file.size() - SessionHeaderSize;
+    uint64_t count = GetU64(data + 16), current = GetU64(data + 24);
+
+    std::vector<SessionTab> tabs;
+    if (count == 0 || count > bodySize || HashBytes(body, bodySize) != GetU64(data + 32) || !ReadSessionTabs(body, bodySize, count, tabs))
+        return false;
+
+    s_SessionHistory = (GetU64(data + 8) & SessionHasHistory) != 0;
+
+    size_t first = s_OpenContexts.size();
+    for (const auto &tab : tabs)
+    {
+        std::string path(tab.path);
+        auto &ctx = (tab.flags & TabLoading) ? OpenContext(path) : CreateNewContext();
+        ctx.loadedFile = path;
+        if (!tab.codec.empty())
+            ctx.codec = Codecs::FindByName(std::string(tab.codec));
+    }
+
+    std::vector<uint8_t> failed(tabs.size());
+    JobSystem::Get().ParallelFor(tabs.size(), [&tabs, &failed, first](size_t i) {
+        const auto &tab = tabs[i];
+        auto &ctx = *s_OpenContexts[first + i];
+        if (tab.flags & TabLoading)
+            return;
+
+        ActionRegister::State state;
+        if (!ctx.palette.Decompress(tab.palette) || (!tab.history.empty() && !Journal::LoadHistory(tab.history, state)))
+        {
+            failed[i] = 1;
+            return;
+        }
+
+        ctx.actionRegister.SetState(std::move(state));
+        if (tab.flags & TabSaved)
+            ctx.savedHash = tab.savedHash;
+        else
+            ctx.savedHash.reset();
+    });
+
+    Context *selected = s_OpenContexts[first + std::min<size_t>(current, count - 1)].get();
+    for (size_t i = tabs.size(); i-- > 0;)
+    {
+        if (failed[i])
+            RemoveContext(first + i);
+    }
+
+    // Loading tabs open theirs once the file is read, unsaved tabs on their
+    // next save, like in SetJournalEnabled.
+    if (s_JournalEnabled)
+    {
+        for (size_t i = first; i < s_OpenContexts.size(); ++i)
+        {
+            auto &ctx = *s_OpenContexts[i];
+            if (!ctx.IsLoading() && !ctx.loadedFile.empty() && ctx.savedHash)
+                ctx.journal.Open(ctx.loadedFile, *ctx.savedHash);
+        }
+    }
+
+    s_CurrentContext = nullptr;
+    for (size_t i = first; i < s_OpenContexts.size(); ++i)
+    {
+        if (s_OpenContexts[i].get() == selected)
+            s_CurrentContext = selected;
+    }
+    if (!s_CurrentContext && !s_OpenContexts.empty())
+        s_CurrentContext = s_OpenContexts.back().get();
+
+    EnforceMemoryBudget();
+    return s_OpenContexts.size() > first;
+}
+
+Context::MemoryUsage Context::GetTotalMemoryUsage()
+{
+    MemoryUsage total;
+    for (const auto &ctx : s_OpenContexts)
+    {
+        auto usage = ctx->GetMemoryUsage();
+        total.palette += usage.palette;
+        total.history += usage.history;
+        total.spilled += usage.spilled;
+    }
+    return total;
+}
+
+void Context::SetMemoryBudget(size_t bytes)
+{
+    s_MemoryBudget = bytes;
+    EnforceMemoryBudget();
+}
+
+void Context::EnforceMemoryBudget()
+{
+    TRACE_SCOPE("Context::EnforceMemoryBudget");
+    if (s_MemoryBudget == 0)
+        return;
+
+    size_t used = GetTotalMemoryUsage().Total();
+    if (used <= s_MemoryBudget)
+        return;
+
+    std::vector<Context *> candidates;
+    for (const auto &ctx : s_OpenContexts)
+    {
+        if (ctx.get() != s_CurrentContext && !ctx->IsCompacted() && !ctx->IsLoading())
+            candidates.push_back(ctx.get());
+    }
+
+    std::sort(candidates.begin(), candidates.end(), [](const Context *a, const Context *b) { return a->m_LastUsed < b->m_LastUsed; });
+
+    for (auto *ctx : candidates)
+    {
+        if (used <= s_MemoryBudget)
+            break;
+
+        // Chunks shared with other tabs are not freed, so this is only an
+        // estimate; the next call catches what is left over.
+        size_t before = ctx->GetMemoryUsage().Total();
+        if (ctx->Compact())
+            used -= std::min(used, before - std::min(before, ctx->GetMemoryUsage().Total()));
+    }
 }
@@ -0,0 +1,181 @@
+#include "dedupe.hpp"
+#include "codecs.hpp"
+#include "io.hpp"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <map>
+
+static constexpr char sText_IndexHeader[] = "palette-dedupe-index 1";
+
+namespace
+{
+    bool StatFile(const std::string &fname, uint64_t &size, int64_t &modifiedTime)
+    {
+        std::error_code ec;
+        size = std::filesystem::file_size(fname, ec);
+        if (ec)
+            return false;
+
+        auto time = std::filesystem::last_write_time(fname, ec);
+        if (ec)
+            return false;
+
+        modifiedTime = time.time_since_epoch().count();
+        return true;
+    }
+
+    void HashFile(const std::string &fname, DedupeIndex::Entry &entry)
+    {
+        entry.valid = false;
+
+        io::MappedFile file(fname);
+        if (!file.IsOpen())
+            return;
+
+        try
+        {
+            auto data = file.GetSpan();
+            auto codec = Codecs::Detect(data, data.size(), fname);
+            if (!codec)
+                return;
+
+            Palette palette;
+            codec->Decode(palette, data);
+
+            entry.hash = palette.Hash();
+            entry.numColors = palette.size();
+            entry.valid = true;
+        }
+        catch (...)
+        {
+            // Unreadable palettes are remembered too, so they are not
+            // parsed again until they change.
+        }
+    }
+}
+
+bool DedupeIndex::Load(const std::string &fname)
+{
+    std::ifstream stream(fname);
+    if (!stream.is_open())
+        return false;
+
+    std::string line;
+    if (!std::getline(stream, line) || line != sText_IndexHeader)
+        return false;
+
+    while (std::getline(stream, line))
+    {
+        Entry entry;
+        unsigned long long hash, size, numColors;
+        long long modifiedTime;
+        int valid, offset = 0;
+
+        if (std::sscanf(line.c_str(), "%llx %llu %lld %llu %d %n", &hash, &size, &modifiedTime, &numColors, &valid, &offset) != 5 || offset == 0)
+            continue;
+
+        entry.hash = hash;
+        entry.fileSize = size;
+        entry.modifiedTime = modifiedTime;
+        entry.numColors = numColors;
+        entry.valid = valid != 0;
+        m_Entries[line.substr(offset)] = entry;
+    }
+
+    return true;
+}
+
+bool DedupeIndex::Save(const std::string &fname) const
+{
+    std::string buffer = sText_IndexHeader;
+    buffer += '\n';
+
+    char line[128];
+    for (const auto &[key, entry] : m_Entries)
+    {
+        std::snprintf(line, sizeof(line), "%016" PRIx64 " %" PRIu64 " %" PRId64 " %zu %d ",
+            entry.hash, entry.fileSize, entry.modifiedTime, entry.numColors, entry.valid ? 1 : 0);
+        buffer += line;
+        buffer += key;
+        buffer += '\n';
+    }
+
+    return io::WriteFileAtomic(fname, buffer);
+}
+
+size_t DedupeIndex::Refresh(const std::vector<std::string> &files, JobSystem &pool)
+{
+    std::vector<std::pair<std::string, Entry>> stale;
+
+    for (const auto &fname : files)
+    {
+        Entry entry;
+        if (!StatFile(fname, entry.fileSize, entry.modifiedTime))
+            continue;
+
+        auto it = m_Entries.find(fname);
+        if (it != m_Entries.end() && it->second.fileSize == entry.fileSize && it->second.modifiedTime == entry.modifiedTime)
+            continue;
+
+        stale.emplace_back(fname, entry);
+    }
+
+    pool.ParallelFor(stale.size(), [&stale](size_t i) {
+        HashFile(stale[i].first, stale[i].second);
+    });
+
+    for (auto &[fname, entry] : stale)
+        m_Entries[fname] = entry;
+
+    return stale.size();
+}
+
+void DedupeIndex::Prune()
+{
+    std::erase_if(m_Entries, [](const auto &item) {
+        std::error_code ec;
+        return item.second.fileSize != 0 && !std::filesystem::exists(item.first, ec);
+    });
+}
+
+void DedupeIndex::Update(const std::string &key, const Palette &palette)
+{
+    Entry entry;
+    entry.hash = palette.Hash();
+    entry.numColors = palette.size();
+    entry.valid = true;
+    m_Entries[key] = entry;
+}
+
+void DedupeIndex::Remove(const std::string &key)
+{
+    m_Entries.erase(key);
+}
+
+std::vector<std::vector<std::string>> DedupeIndex::GetDuplicateGroups() const
+{
+    // The color count is part of the key as a cheap guard against collisions.
+    std::map<std::pair<uint64_t, size_t>, std::vector<std::string>> byContent;
+    for (const auto &[key, entry] : m_Entries)
+    {
+        if (entry.valid)
+            byContent[{ entry.hash, entry.numColors }].push_back(key);
+    }
+
+    std::vector<std::vector<std::string>> groups;
+    for (auto &[content, keys] : byContent)
+    {
+        if (keys.size() < 2)
+            continue;
+
+        std::sort(keys.begin(), keys.end());
+        groups.push_back(std::move(keys));
+    }
+
+    std::sort(groups.begin(), groups.end());
+    return groups;
+}
@@ -8,21 +8,31 @@
 
 #include <nfd.h>
 #include <array>
+#include <utility>
+#include <cstdint>
+#include <cstdlib>
 
 #include "editor.hpp"
 #include "fs.hpp"
 #include "palette.hpp"
 #include "context.hpp"
+#include "bgr555.hpp"
+#include "codecs.hpp"
+#include "trace.hpp"
 
 #include "actions/change_color_count.hpp"
 #include "actions/modify_color.hpp"
 #include "actions/swap_colors.hpp"
+#include "actions/transform_colors.hpp"
 
 #include "popups/combine.hpp"
+#include "popups/duplicates.hpp"
 #include "popups/error.hpp"
 #include "popups/logger.hpp"
+#include "popups/macros.hpp"
 #include "popups/prompt.hpp"
 #include "popups/split.hpp"
+#include "popups/transform_colors.hpp"
 
 enum 
 {
@@ -59,20 +69,78 @@ static constexpr std::array<const char*, COUNT_SHORT> sText_FileShortcuts =
 
 #undef sText_Modifier
 
+static constexpr char sText_SessionFile[] = "palette-editor.session";
+// Written at exit while recording, PALETTE_EDITOR_TRACE=1 records from startup.
+static constexpr char sText_TraceFile[] = "palette-editor.trace.json";
+
+namespace
+{
+    // Frames drawn after each wake-up, so hover and layout changes that
+    // ImGui applies a frame late still show up.
+    constexpr int SettleFrames = 2;
+    // Waiting only times out to blink the text caret, or as a fallback for
+    // anything that forgets to post an event.
+    constexpr double CaretBlinkTimeout = 0.4;
+    constexpr double IdleTimeout = 2.0;
+}
+
 static void glfw_error_callback(int error, const char *description)
 {
     fprintf(stderr, "GLFW Error %d: %s\n", error, description);
 }
 
+// Like ImGui::InputInt, but value only changes once the edit is committed
+// with Enter, by leaving the field or with the step buttons. The number
+// being typed is kept here in the meantime.
+static bool InputIntOnCommit(const char *label, int &value, int step, int step_fast)
+{
+    static ImGuiID s_EditId = 0;
+    static int s_EditValue = 0;
+
+    ImGuiID id = ImGui::GetID(label);
+    int shown = s_EditId == id ? s_EditValue : value;
+    bool changed = ImGui::InputInt(label, &shown, step, step_fast);
+
+    if (ImGui::IsItemActive())
+    {
+        s_EditId = id;
+        s_EditValue = shown;
+        return false;
+    }
+
+    bool edited = s_EditId == id && ImGui::IsItemDeactivatedAfterEdit();
+    if (s_EditId == id)
+        s_EditId = 0;
+
+    if ((!changed && !edited) || shown == value)
+        return false;
+
+    value = shown;
+    return true;
+}
+
 Editor::Editor()
 {
-    Context::CreateNewContext();
+    Trace::SetThreadName("Main");
+    if (const char *trace = std::getenv("PALETTE_EDITOR_TRACE"); trace && *trace && *trace != '0')
+        Trace::SetEnabled(true);
+
     this->InitGLFW();
     this->InitImGui();
+
+    // Tabs that were still loading are opened again, and their jobs post
+    // GLFW events, so GLFW has to be up first. The tab bar would otherwise
+    // select the last restored tab.
+    m_SelectCurrentTab = Context::RestoreSession(sText_SessionFile);
+    if (!m_SelectCurrentTab)
+        Context::CreateNewContext();
 }
 
 Editor::~Editor()
 {
+    Context::SaveSession(sText_SessionFile);
+    if (Trace::IsEnabled())
+        Trace::Save(sText_TraceFile);
     this->ExitImGui();
     this->ExitGLFW();
 }
@@ -109,34 +177,27 @@ void Editor::InitGLFW()
     glfwGetWindowSize(m_Window, &win_w, &win_h);
     glfwGetFramebufferSize(m_Window, &fb_w, &fb_h);
 
+    // Keys are only queued here; the main loop handles them once per frame,
+    // outside of event dispatch.
     glfwSetKeyCallback(m_Window, [](GLFWwindow *window, int key, int scancode, int action, int mods) {
         Editor *editor = static_cast<Editor *>(glfwGetWindowUserPointer(window));
 
         if (action == GLFW_PRESS || action == GLFW_REPEAT)
-        {
-            editor->ProcessShortcuts(key, mods);
-            glfwPollEvents();
-            editor->StartFrame();
-            editor->Frame();
-            editor->EndFrame();
-        }
+            editor->QueueKey(key, mods, action == GLFW_REPEAT);
     });
 
     glfwSetDropCallback(m_Window, [](GLFWwindow *window, int path_count, const char *paths[]) {
         Editor *editor = static_cast<Editor *>(glfwGetWindowUserPointer(window));
 
-        if (path_count <= 0)
-            return;
-
-        std::string path = std::string(paths[0], strlen(paths[0]));
-        if (path.substr(path.find_last_of(".") + 1) != "pal")
-            return;
-        editor->OpenPalette(path.c_str());
+        // Every path becomes a loading tab at once; files that turn out not
+        // to be palettes are closed again with an error.
+        for (int i = 0; i < path_count; ++i)
+            editor->OpenPalette(paths[i]);
     });
 
     glfwSetWindowCloseCallback(m_Window, [](GLFWwindow *window) {
         Editor *editor = static_cast<Editor *>(glfwGetWindowUserPointer(window));
-        if (Context::GetContext().isDirty)
+        if (!Context::HasNoContext() && Context::GetContext().IsDirty())
         {
             glfwSetWindowShouldClose(window, GLFW_FALSE);
             editor->m_PopupManager.OpenPopup<Popups::Prompt>("dirty_buffer_prompt", "There are unsaved changes.\nDo you want to quit?", [window](){
@@ -166,6 +227,7 @@ void Editor::InitImGui(void)
 
 void Editor::StartFrame(void)
 {
+    TRACE_SCOPE("Editor::StartFrame");
     ImGui_ImplOpenGL3_NewFrame();
     ImGui_ImplGlfw_NewFrame();
     ImGui::NewFrame();
@@ -186,23 +248,40 @@ void Editor::StartFrame(void)
 
 void Editor::Frame(void)
 {
+    TRACE_SCOPE("Editor::Frame");
     ImGui::Begin("##PaletteEditor", NULL, 0);
+
+    auto loadErrors = Context::UpdateLoadingContexts();
+    if (!loadErrors.empty())
+    {
+        std::string message;
+        for (const auto &error : loadErrors)
+            message += (message.empty() ? "" : "\n") + error;
+        m_PopupManager.OpenPopup<Popups::Error>("open_error", message);
+    }
+
     auto &openContexts = Context::GetOpenContexts();
 
     if (!openContexts.empty())
     {
         if (ImGui::BeginTabBar("##OpenedFiles", ImGuiTabBarFlags_AutoSelectNewTabs | ImGuiTabBarFlags_Reorderable))
         {
+            Context *selected = m_SelectCurrentTab && !Context::HasNoContext() ? &Context::GetContext() : nullptr;
+            m_SelectCurrentTab = false;
 
             for (size_t i = 0; i < openContexts.size(); ++i)
             {
                 auto &ctx = openContexts[i];
                 auto name = ctx->loadedFile.empty() ? "Untitled" : fs::GetFilename(ctx->loadedFile);
+                // Keeps the tab id stable when the loading suffix goes away.
+                name += ctx->IsLoading() ? " (loading)###tab" : "###tab";
 
                 bool isOpen = true;
                 ImGui::PushID(ctx.get());
 
-                int flags = (ctx->isDirty ? ImGuiTabItemFlags_UnsavedDocument : 0) | ImGuiTabItemFlags_NoTooltip;
+                int flags = (ctx->IsDirty() ? ImGuiTabItemFlags_UnsavedDocument : 0) | ImGuiTabItemFlags_NoTooltip;
+                if (ctx.get() == selected)
+                    flags |= ImGuiTabItemFlags_SetSelected;
 
                 if (ImGui::BeginTabItem(name.c_str(), &isOpen, flags))
                 {
@@ -210,31 +289,37 @@ void Editor::Frame(void)
                     ImGui::EndTabItem();
                 }
 
+                ImGui::PopID();
+
                 if (!isOpen)
                 {
-                    if (Context::GetContext().isDirty)
+                    // Loading tabs that fail are removed on their own, so
+                    // the prompt finds the tab again by its address.
+                    if (ctx->IsDirty())
                     {
                         m_PopupManager.OpenPopup<Popups::Prompt>(
                             "dirty_buffer_prompt",
                             "This palette has unsaved changes.\nDo you want to close?",
-                            [i](void)
+                            [closing = ctx.get()](void)
                             {
-                                Context::RemoveContext(i);
+                                Context::RemoveContext(closing);
                             }
                         );
                     }
                     else
                     {
-                        Context::RemoveContext(i);
+                        Context::RemoveContext(i--);
                     }
                 }
-
-                ImGui::PopID();
             }
 
             ImGui::Spacing();
 
-            if (!Context::HasNoContext())
+            if (!Context::HasNoContext() && Context::GetContext().IsLoading())
+            {
+                ImGui::TextWrapped("Loading %s...", Context::GetContext().loadedFile.c_str());
+            }
+            else if (!Context::HasNoContext())
             {
                 this->DetailsBar();
                 ImGui::Spacing();
@@ -258,6 +343,7 @@ void Editor::Frame(void)
 
 void Editor::EndFrame(void)
 {
+    TRACE_SCOPE("Editor::EndFrame");
     int display_w, display_h;
 
     ImGui::Render();
@@ -267,6 +353,7 @@ void Editor::EndFrame(void)
     glClear(GL_COLOR_BUFFER_BIT);
     ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
     glfwSwapBuffers(m_Window);
+    ++m_FrameCount;
 }
 
 void Editor::Loop(void)
@@ -274,18 +361,91 @@ void Editor::Loop(void)
     while (!glfwWindowShouldClose(m_Window))
     {
         if (glfwGetWindowAttrib(m_Window, GLFW_ICONIFIED) || 
-            !glfwGetWindowAttrib(m_Window, GLFW_FOCUSED) ||
+            (!m_LazyRedraw && !glfwGetWindowAttrib(m_Window, GLFW_FOCUSED)) ||
             !glfwGetWindowAttrib(m_Window, GLFW_VISIBLE))
         {
             glfwWaitEvents();
+            continue;
         }
-        else
+
+        bool continuous = !m_LazyRedraw || m_PendingFrames > 0;
+        if (continuous)
         {
             glfwPollEvents();
-            this->StartFrame();
-            this->Frame();
-            this->EndFrame();
+            m_PendingFrames = std::max(0, m_PendingFrames - 1);
+        }
+        else
+        {
+            // Returns on input, window events and glfwPostEmptyEvent from
+            // finished jobs.
+            glfwWaitEventsTimeout(ImGui::GetIO().WantTextInput ? CaretBlinkTimeout : IdleTimeout);
+            m_PendingFrames = SettleFrames;
         }
+
+        double frameStart = glfwGetTime();
+        double inputTime = this->ProcessInput();
+
+        this->StartFrame();
+        this->Frame();
+        this->EndFrame();
+
+        this->UpdateFrameStats(frameStart, inputTime, continuous);
+
+        // Dragging and held buttons change the UI without new events.
+        if (ImGui::IsAnyItemActive() || ImGui::IsAnyMouseDown())
+            m_PendingFrames = std::max(m_PendingFrames, 1);
+    }
+}
+
+void Editor::QueueKey(int key, int mods, bool repeat)
+{
+    // A held key repeats faster than frames come when rendering is slow;
+    // one repeat per key and frame is enough.
+    if (repeat && !m_KeyQueue.empty())
+    {
+        const auto &last = m_KeyQueue.back();
+        if (last.repeat && last.key == key && last.mods == mods)
+            return;
+    }
+
+    m_KeyQueue.push_back({ key, mods, repeat, glfwGetTime() });
+}
+
+double Editor::ProcessInput(void)
+{
+    TRACE_SCOPE("Editor::ProcessInput");
+    if (m_KeyQueue.empty())
+        return -1.0;
+
+    // File dialogs run their own event loop, so keys can be queued while
+    // these are handled.
+    auto keys = std::move(m_KeyQueue);
+    m_KeyQueue.clear();
+    for (const auto &event : keys)
+        this->ProcessShortcuts(event.key, event.mods);
+
+    return keys.front().time;
+}
+
+void Editor::UpdateFrameStats(double frameStart, double inputTime, bool continuous)
+{
+    double now = glfwGetTime();
+
+    // Smoothed, so the numbers can be read while they update.
+    auto smooth = [](double &average, double value) {
+        average = average == 0.0 ? value : average * 0.9 + value * 0.1;
+    };
+
+    smooth(m_FrameStats.frameTime, now - frameStart);
+    // Waiting for input is not part of the pacing.
+    if (continuous && m_LastFrameEnd != 0.0)
+        smooth(m_FrameStats.frameInterval, now - m_LastFrameEnd);
+    m_LastFrameEnd = now;
+
+    if (inputTime >= 0.0)
+    {
+        m_FrameStats.inputLatency = now - inputTime;
+        m_FrameStats.maxInputLatency = std::max(m_FrameStats.maxInputLatency, m_FrameStats.inputLatency);
     }
 }
 
@@ -312,16 +472,28 @@ void Editor::MenuBar(void)
                 Context::CreateNewContext();
             if (ImGui::MenuItem("Open", sText_FileShortcuts[SHORT_OPEN])) 
                 PromptOpenPalette();
-            if (ImGui::MenuItem("Save", sText_FileShortcuts[SHORT_SAVE])) 
+            if (ImGui::MenuItem("Save", sText_FileShortcuts[SHORT_SAVE], nullptr, Context::HasEditableContext())) 
                 SavePalette(false);
-            if (ImGui::MenuItem("Save As", sText_FileShortcuts[SHORT_SAVE_AS]))
+            if (ImGui::MenuItem("Save As", sText_FileShortcuts[SHORT_SAVE_AS], nullptr, Context::HasEditableContext()))
                 SavePalette(true);
-            if (ImGui::MenuItem("Logger", nullptr))
+            if (ImGui::MenuItem("Save All", nullptr, nullptr, !Context::HasNoContext()))
+                SaveAllPalettes();
+            if (ImGui::MenuItem("Export Strict JASC-PAL", nullptr, nullptr, Context::HasEditableContext()))
+                ExportStrictPalette();
+            if (ImGui::MenuItem("Duplicate Tab", nullptr, nullptr, Context::HasEditableContext()))
+                Context::DuplicateContext(Context::GetContext());
+            bool keepJournal = Context::IsJournalEnabled();
+            if (ImGui::MenuItem("Keep Undo Journal", nullptr, &keepJournal))
+                Context::SetJournalEnabled(keepJournal);
+            bool sessionHistory = Context::IsSessionHistoryEnabled();
+            if (ImGui::MenuItem("Keep Undo History in Session", nullptr, &sessionHistory))
+                Context::SetSessionHistoryEnabled(sessionHistory);
+            if (ImGui::MenuItem("Logger", nullptr, nullptr, Context::HasEditableContext()))
                 m_PopupManager.OpenPopup<Popups::Logger>();
             if (ImGui::MenuItem("Quit", sText_FileShortcuts[SHORT_QUIT]))
             {
                 const char *s;
-                if (Context::GetContext().isDirty)
+                if (!Context::HasNoContext() && Context::GetContext().IsDirty())
                     s = "There are unsaved changes.\nDo you want to quit?";
                 else
                     s = "Do you want to quit?";
@@ -335,23 +507,51 @@ void Editor::MenuBar(void)
 
         if (ImGui::BeginMenu("Edit"))
         {
-            if (ImGui::MenuItem("Undo", sText_FileShortcuts[SHORT_UNDO], nullptr, Context::GetContext().actionRegister.CanUndo())) 
-            {
+            if (ImGui::MenuItem("Undo", sText_FileShortcuts[SHORT_UNDO], nullptr, Context::HasEditableContext() && Context::GetContext().actionRegister.CanUndo())) 
                 Context::GetContext().actionRegister.Undo();
-                Context::GetContext().isDirty = true;
+            if (ImGui::MenuItem("Redo", sText_FileShortcuts[SHORT_REDO], nullptr, Context::HasEditableContext() && Context::GetContext().actionRegister.CanRedo())) 
+                Context::GetContext().actionRegister.Redo();
+            if (ImGui::MenuItem("Snap Colors to 15-bit", nullptr, nullptr, Context::HasEditableContext()))
+                SnapPaletteTo15Bit();
+            if (ImGui::MenuItem("Transform Colors...", nullptr, nullptr, Context::HasEditableContext()))
+                m_PopupManager.OpenPopup<Popups::TransformColors>();
+            ImGui::Separator();
+            if (!IsRecordingMacro())
+            {
+                if (ImGui::MenuItem("Start Recording Macro", nullptr, nullptr, Context::HasEditableContext()))
+                {
+                    m_Macro->Clear();
+                    Context::GetContext().recordingMacro = m_Macro;
+                }
             }
-            if (ImGui::MenuItem("Redo", sText_FileShortcuts[SHORT_REDO], nullptr, Context::GetContext().actionRegister.CanRedo())) 
+            else if (ImGui::MenuItem("Stop Recording Macro"))
             {
-                Context::GetContext().actionRegister.Redo();
-                Context::GetContext().isDirty = true;
+                for (auto &ctx : Context::GetOpenContexts())
+                    ctx->recordingMacro.reset();
             }
+            ImGui::Separator();
+            this->HistoryLimits();
+            ImGui::Separator();
+            this->MemoryBudget();
+            ImGui::EndMenu();
+        }
+
+        if (ImGui::BeginMenu("View"))
+        {
+            ImGui::MenuItem("Snap to 15-bit (GBA)", nullptr, &m_Snap15Bit);
+            ImGui::MenuItem("Redraw Only on Input", nullptr, &m_LazyRedraw);
+            ImGui::MenuItem("Grid Layout", nullptr, &m_GridLayout);
             ImGui::EndMenu();
         }
 
         if (ImGui::BeginMenu("Others"))
         {
             if (ImGui::MenuItem("Combine Palettes", sText_FileShortcuts[SHORT_COMBINE])) m_PopupManager.OpenPopup<Popups::Combine>();
-            if (ImGui::MenuItem("Split Palette", sText_FileShortcuts[SHORT_SPLIT], nullptr, !Context::HasNoContext())) m_PopupManager.OpenPopup<Popups::Split>();
+            if (ImGui::MenuItem("Split Palette", sText_FileShortcuts[SHORT_SPLIT], nullptr, Context::HasEditableContext())) m_PopupManager.OpenPopup<Popups::Split>();
+            if (ImGui::MenuItem("Find Duplicate Tabs", nullptr, nullptr, Context::HasEditableContext())) m_PopupManager.OpenPopup<Popups::Duplicates>();
+            if (ImGui::MenuItem("Macros...")) m_PopupManager.OpenPopup<Popups::Macros>(m_Macro);
+            ImGui::Separator();
+            this->TraceMenu();
             ImGui::EndMenu();
         }
 
@@ -364,74 +564,227 @@ void Editor::DetailsBar(void)
     int num_colors = Context::GetContext().palette.size();
 
     if (ImGui::InputInt("No. of Colors", &num_colors))
-        num_colors = std::min(std::max(1, num_colors), 256);
+        num_colors = std::min(std::max(1, num_colors), (int)Palette::MaxColors);
 
     if (ImGui::IsItemDeactivatedAfterEdit() && Context::GetContext().palette.size() != num_colors)
     {
         Context::GetContext().actionRegister.RegisterAction<Actions::ChangeColorCount>(Context::GetContext().palette.size(), (size_t)num_colors);
-        Context::GetContext().isDirty = true;
     }
 
     ImGui::TextWrapped("Path:\n%s", Context::GetContext().loadedFile.empty() ? "No file opened." : Context::GetContext().loadedFile.c_str());
 }
 
-void Editor::PaletteEditor(void)
+// Large palettes are easier to take in as a grid; only the selected color
+// gets an editing widget.
+void Editor::PaletteGrid(void)
 {
     static bool hasCachedColor = false;
     static Color cachedColor;
-    auto &palette = Context::GetContext().palette;
+    auto &ctx = Context::GetContext();
+    auto &palette = ctx.palette;
 
-    ImGui::BeginChild("Colors", ImVec2(0.0f, 0.0f), true, ImGuiWindowFlags_AlwaysAutoResize);
-    for (int i = 0; i < palette.size(); i++)
+    size_t selected = m_SwatchView.GetSelected();
+    if (selected >= palette.size())
     {
-        char label[20];
-        snprintf(label, 20, "Color #%i", i);
-
-        auto &color = palette[i];
-        ImGui::ColorEdit3(label, (float *)&color, ImGuiColorEditFlags_NoDragDrop);
+        hasCachedColor = false;
+        ImGui::TextDisabled("Click a color to edit it.");
+    }
+    else
+    {
+        Color color = std::as_const(palette)[selected];
+        auto components = (m_Snap15Bit && !hasCachedColor ? bgr555::Snap(color) : color).ToFloat();
+        if (ImGui::ColorEdit3("##selected", components.data(), ImGuiColorEditFlags_NoDragDrop))
+            palette[selected] = color = Color::FromFloat(components.data());
 
-        if (ImGui::IsItemActivated())
+        if (ImGui::IsItemActivated() && !hasCachedColor)
         {
-            if (!hasCachedColor)
-                cachedColor = palette[i];
-
+            cachedColor = color;
             hasCachedColor = true;
         }
 
         if (ImGui::IsItemDeactivatedAfterEdit())
         {
-            Context::GetContext().actionRegister.RegisterAction<Actions::ModifyColor>(i, cachedColor, color);
-            Context::GetContext().isDirty = true;
+            Color newColor = m_Snap15Bit ? bgr555::Snap(color) : color;
+            ctx.actionRegister.RegisterAction<Actions::ModifyColor>(selected, cachedColor, newColor);
             hasCachedColor = false;
         }
 
-        if (ImGui::BeginDragDropSource(ImGuiDragDropFlags_SourceAllowNullID))
-        {
-            ImGui::SetDragDropPayload("ColorDND", &i, sizeof(size_t));
+        ImGui::SameLine(0.0f, ImGui::GetStyle().ItemInnerSpacing.x);
+        ImGui::Text("Color #%zu", selected);
+    }
 
-            const auto &col = palette[i];
-            const ImVec4 col_v4(col[0], col[1], col[2], 1.0f);
-            ImGui::ColorButton("##preview", col_v4); ImGui::SameLine();
-            ImGui::Text("Color");
-            ImGui::EndDragDropSource();
-        }
+    if (m_SwatchView.Draw("Colors", palette))
+    {
+        size_t from, to;
+        m_SwatchView.GetSwap(from, to);
+        ctx.actionRegister.RegisterAction<Actions::SwapColors>(from, to);
+    }
+
+    // Selection can't move while a color is being edited, the undo record
+    // would otherwise go to the wrong index.
+    if (hasCachedColor)
+        m_SwatchView.SetSelected(selected);
+}
+
+void Editor::PaletteEditor(void)
+{
+    if (m_GridLayout)
+    {
+        PaletteGrid();
+        return;
+    }
+
+    static bool hasCachedColor = false;
+    static Color cachedColor;
+    static size_t cachedIndex = 0;
+    static size_t dragSource = SIZE_MAX;
+    auto &palette = Context::GetContext().palette;
+
+    ImGui::BeginChild("Colors", ImVec2(0.0f, 0.0f), true, ImGuiWindowFlags_AlwaysAutoResize);
 
-        if (ImGui::BeginDragDropTarget())
+    const ImGuiPayload *dragPayload = ImGui::GetDragDropPayload();
+    bool isDragging = dragPayload && dragPayload->IsDataType("ColorDND");
+    if (!isDragging)
+        dragSource = SIZE_MAX;
+
+    // Holding a dragged color near the top or bottom edge scrolls, so it
+    // can be dropped anywhere in the palette.
+    if (isDragging && ImGui::IsWindowHovered(ImGuiHoveredFlags_AllowWhenBlockedByActiveItem))
+    {
+        float y = ImGui::GetMousePos().y - ImGui::GetWindowPos().y;
+        float edge = ImGui::GetFrameHeight() * 2.0f;
+        float step = ImGui::GetFrameHeightWithSpacing() * 20.0f * ImGui::GetIO().DeltaTime;
+        if (y < edge)
+            ImGui::SetScrollY(ImGui::GetScrollY() - step);
+        else if (y > ImGui::GetWindowHeight() - edge)
+            ImGui::SetScrollY(ImGui::GetScrollY() + step);
+    }
+
+    // Only the visible rows submit widgets. The row being edited and the
+    // one being dragged stay submitted when scrolled away, or ImGui would
+    // end the edit or the drag.
+    ImGuiListClipper clipper;
+    clipper.Begin(static_cast<int>(palette.size()));
+    if (hasCachedColor && cachedIndex < palette.size())
+        clipper.IncludeItemByIndex(static_cast<int>(cachedIndex));
+    if (dragSource < palette.size())
+        clipper.IncludeItemByIndex(static_cast<int>(dragSource));
+
+    while (clipper.Step())
+    {
+        for (size_t i = clipper.DisplayStart; i < (size_t)clipper.DisplayEnd; i++)
         {
-            if (const ImGuiPayload* payload = ImGui::AcceptDragDropPayload("ColorDND"))
+            ImGui::PushID(static_cast<int>(i));
+
+            // Read through const, so drawing never unshares a chunk.
+            Color color = std::as_const(palette)[i];
+            bool isEditing = hasCachedColor && cachedIndex == i;
+
+            // The color being edited is shown as is, snapping it every frame
+            // would fight the widget's dragging.
+            auto components = (m_Snap15Bit && !isEditing ? bgr555::Snap(color) : color).ToFloat();
+            if (ImGui::ColorEdit3("##color", components.data(), ImGuiColorEditFlags_NoDragDrop))
+                palette[i] = color = Color::FromFloat(components.data());
+
+            if (ImGui::IsItemActivated())
+            {
+                if (!hasCachedColor)
+                {
+                    cachedColor = color;
+                    cachedIndex = i;
+                }
+
+                hasCachedColor = true;
+            }
+
+            if (ImGui::IsItemDeactivatedAfterEdit())
+            {
+                Color newColor = m_Snap15Bit ? bgr555::Snap(color) : color;
+                Context::GetContext().actionRegister.RegisterAction<Actions::ModifyColor>(i, cachedColor, newColor);
+                hasCachedColor = false;
+            }
+
+            if (ImGui::BeginDragDropSource(ImGuiDragDropFlags_SourceAllowNullID))
+            {
+                dragSource = i;
+                ImGui::SetDragDropPayload("ColorDND", &i, sizeof(size_t));
+
+                const auto col = color.ToFloat();
+                const ImVec4 col_v4(col[0], col[1], col[2], 1.0f);
+                ImGui::ColorButton("##preview", col_v4); ImGui::SameLine();
+                ImGui::Text("Color");
+                ImGui::EndDragDropSource();
+            }
+
+            if (ImGui::BeginDragDropTarget())
             {
-                IM_ASSERT(payload->DataSize == sizeof(size_t));
-                int target = *(const size_t*)payload->Data;
-                Context::GetContext().actionRegister.RegisterAction<Actions::SwapColors>(i, target);
-                Context::GetContext().isDirty = true;
+                if (const ImGuiPayload* payload = ImGui::AcceptDragDropPayload("ColorDND"))
+                {
+                    IM_ASSERT(payload->DataSize == sizeof(size_t));
+                    size_t target = *(const size_t*)payload->Data;
+                    Context::GetContext().actionRegister.RegisterAction<Actions::SwapColors>(i, target);
+                }
+                ImGui::EndDragDropTarget();
             }
-            ImGui::EndDragDropTarget();
+
+            ImGui::SameLine(0.0f, ImGui::GetStyle().ItemInnerSpacing.x);
+            ImGui::Text("Color #%zu", i);
+            ImGui::PopID();
         }
     }
 
     ImGui::EndChild();
 }
 
+void Editor::TraceMenu(void)
+{
+    bool recording = Trace::IsEnabled();
+    if (ImGui::MenuItem("Record Trace", nullptr, &recording))
+    {
+        if (recording)
+            Trace::Clear();
+        Trace::SetEnabled(recording);
+    }
+
+    if (ImGui::MenuItem("Save Trace..."))
+    {
+        fs::SaveFilePrompt([this](const char *path) {
+            if (!Trace::Save(path))
+                m_PopupManager.OpenPopup<Popups::Error>("trace_error", "Could not write the trace file.");
+        }, fs::FileType::Trace);
+    }
+}
+
+void Editor::HistoryLimits(void)
+{
+    auto limits = ActionRegister::GetDefaultLimits();
+    int maxActions = (int)limits.maxActions;
+    int maxMegabytes = (int)(limits.maxBytes >> 20);
+
+    ImGui::TextDisabled("Undo history (0 = unlimited)");
+    bool changed = InputIntOnCommit("Max Steps", maxActions, 100, 1000);
+    changed |= InputIntOnCommit("Max MB", maxMegabytes, 1, 16);
+
+    if (!changed)
+        return;
+
+    limits.maxActions = (size_t)std::max(0, maxActions);
+    limits.maxBytes = (size_t)std::max(0, maxMegabytes) << 20;
+    ActionRegister::SetDefaultLimits(limits);
+
+    for (auto &ctx : Context::GetOpenContexts())
+        ctx->actionRegister.SetLimits(limits);
+}
+
+void Editor::MemoryBudget(void)
+{
+    int budgetMegabytes = (int)(Context::GetMemoryBudget() >> 20);
+
+    ImGui::TextDisabled("Memory for all tabs (0 = unlimited)");
+    if (InputIntOnCommit("Budget MB", budgetMegabytes, 16, 256))
+        Context::SetMemoryBudget((size_t)std::max(0, budgetMegabytes) << 20);
+}
+
 void Editor::StatusBar(void)
 {
     const ImGuiViewport *viewport = ImGui::GetMainViewport();
@@ -453,10 +806,25 @@ void Editor::StatusBar(void)
     ImGui::Begin("##StatusBar", nullptr, flags);
 
     ImGui::SetCursorPosX(8);
-    if (ImGui::BeginMenuBar())
+    if (!Context::HasNoContext() && ImGui::BeginMenuBar())
     {
-        const auto &undoStack = Context::GetContext().actionRegister.GetRedoStack(), &redoStack = Context::GetContext().actionRegister.GetUndoStack();
-        ImGui::Text("Action Stack: %lu (Undo) | %lu (Redo)", undoStack.size(), redoStack.size());
+        const auto &actions = Context::GetContext().actionRegister;
+        ImGui::Text("Action Stack: %zu (Undo) | %zu (Redo)", actions.GetUndoCount(), actions.GetRedoCount());
+
+        auto usage = Context::GetContext().GetMemoryUsage();
+        auto total = Context::GetTotalMemoryUsage();
+        ImGui::Text("| Memory: %.1f KB (Palette) | %.1f KB (History) | All Tabs: %.1f MB", usage.palette / 1024.0, usage.history / 1024.0, total.Total() / 1048576.0);
+        if (Context::GetMemoryBudget() != 0)
+            ImGui::Text("of %zu MB", Context::GetMemoryBudget() >> 20);
+        if (total.spilled != 0)
+            ImGui::Text("(%.1f MB on Disk)", total.spilled / 1048576.0);
+        ImGui::Text("| Frames: %llu", (unsigned long long)m_FrameCount);
+        if (ImGui::IsItemHovered())
+        {
+            ImGui::SetTooltip("Frame time: %.2f ms\nFrame interval: %.2f ms\nInput latency: %.2f ms (max %.2f ms)",
+                m_FrameStats.frameTime * 1000.0, m_FrameStats.frameInterval * 1000.0,
+                m_FrameStats.inputLatency * 1000.0, m_FrameStats.maxInputLatency * 1000.0);
+        }
         ImGui::EndMenuBar();
     }
 
@@ -466,7 +834,7 @@ void Editor::StatusBar(void)
 
 void Editor::OpenPalette(const char *path)
 {
-    Context::CreateNewContext(path);
+    Context::OpenContext(path);
 }
 
 void Editor::PromptOpenPalette(void)
@@ -476,14 +844,110 @@ void Editor::PromptOpenPalette(void)
 
 void Editor::SavePalette(bool promptFilepath)
 {
-    if (Context::GetContext().loadedFile.empty() || promptFilepath)
+    if (!Context::HasEditableContext())
+        return;
+
+    auto &ctx = Context::GetContext();
+    if (ctx.loadedFile.empty() || promptFilepath)
     {
-        if (!fs::SaveFilePrompt([](const char *path) { Context::GetContext().loadedFile = path; }))
+        if (!fs::SaveFilePrompt([&ctx](const char *path) { ctx.loadedFile = path; }))
             return;
+
+        // A new extension picks its own format.
+        if (ctx.codec && !ctx.codec->HasExtension(ctx.loadedFile))
+            ctx.codec = nullptr;
+    }
+    else if (!ctx.IsDirty() && fs::Exists(ctx.loadedFile))
+    {
+        return;
+    }
+
+    // The tab stays dirty when the palette does not fit its format.
+    try
+    {
+        if (!ctx.palette.SaveToFile(ctx.loadedFile, ctx.codec))
+        {
+            m_PopupManager.OpenPopup<Popups::Error>("save_error", "Could not write the palette file.");
+            return;
+        }
+    }
+    catch (const char *e)
+    {
+        m_PopupManager.OpenPopup<Popups::Error>("save_error", e);
+        return;
+    }
+
+    ctx.MarkSaved();
+}
+
+void Editor::SaveAllPalettes(void)
+{
+    std::string errors;
+
+    for (auto &ctx : Context::GetOpenContexts())
+    {
+        if (ctx->IsLoading() || ctx->loadedFile.empty() || !ctx->IsDirty())
+            continue;
+
+        ctx->Expand();
+        try
+        {
+            if (ctx->palette.SaveToFile(ctx->loadedFile, ctx->codec))
+                ctx->MarkSaved();
+            else
+                errors += fs::GetFilename(ctx->loadedFile) + ": Could not write the palette file.\n";
+        }
+        catch (const char *e)
+        {
+            errors += fs::GetFilename(ctx->loadedFile) + ": " + e + "\n";
+        }
     }
 
-    Context::GetContext().palette.SaveToFile(Context::GetContext().loadedFile);
-    Context::GetContext().isDirty = false;
+    Context::EnforceMemoryBudget();
+
+    if (!errors.empty())
+        m_PopupManager.OpenPopup<Popups::Error>("save_error", errors);
+}
+
+void Editor::ExportStrictPalette(void)
+{
+    fs::SaveFilePrompt([this](const char *path) {
+        try
+        {
+            if (!Context::GetContext().palette.SaveToFile(path, Codecs::FindByName("jasc-strict")))
+                m_PopupManager.OpenPopup<Popups::Error>("save_error", "Could not write the palette file.");
+        }
+        catch (const char *e)
+        {
+            m_PopupManager.OpenPopup<Popups::Error>("save_error", e);
+        }
+    });
+}
+
+void Editor::SnapPaletteTo15Bit(void)
+{
+    auto &ctx = Context::GetContext();
+    const auto &colors = ctx.palette;
+
+    size_t i = 0;
+    while (i < colors.size() && bgr555::Snap(colors[i]) == colors[i])
+        ++i;
+    if (i == colors.size())
+        return;
+
+    // One range step that keeps the old colors as a slice, rather than a
+    // record per color.
+    ctx.actionRegister.RegisterAction<Actions::TransformColors>(0, colors.size(), Transform::Snap15Bit());
+}
+
+bool Editor::IsRecordingMacro(void) const
+{
+    for (const auto &ctx : Context::GetOpenContexts())
+    {
+        if (ctx->recordingMacro)
+            return true;
+    }
+    return false;
 }
 
 void Editor::ProcessShortcuts(int key, int mods)
@@ -511,19 +975,19 @@ void Editor::ProcessShortcuts(int key, int mods)
                 SavePalette(false);
             break;
         case GLFW_KEY_Z:
-            Context::GetContext().actionRegister.Undo();
-            Context::GetContext().isDirty = true;
+            if (Context::HasEditableContext())
+                Context::GetContext().actionRegister.Undo();
             break;
         case GLFW_KEY_R:
-            Context::GetContext().actionRegister.Redo();
-            Context::GetContext().isDirty = true;
+            if (Context::HasEditableContext())
+                Context::GetContext().actionRegister.Redo();
             break;
         case GLFW_KEY_K:
             if (mods & GLFW_MOD_SHIFT)
                 m_PopupManager.OpenPopup<Popups::Combine>();
             break;
         case GLFW_KEY_L:
-            if (mods & GLFW_MOD_SHIFT && !Context::HasNoContext())
+            if (mods & GLFW_MOD_SHIFT && Context::HasEditableContext())
                 m_PopupManager.OpenPopup<Popups::Split>();
             break;
         }
@@ -1,10 +1,53 @@
 #include "fs.hpp"
 #include "nfd.h"
+#include "codecs.hpp"
+#include "macro.hpp"
 #include <filesystem>
+#include <vector>
+#include <algorithm>
 
 namespace 
 {
-    const nfdfilteritem_t sFilterPatterns[] = { {"Palette Files", "pal"} };
+    // One "all palettes" entry followed by one entry per codec extension list.
+    const std::vector<nfdfilteritem_t> &GetFilterPatterns()
+    {
+        static std::string allExtensions;
+        static std::vector<nfdfilteritem_t> patterns;
+
+        if (patterns.empty())
+        {
+            std::vector<std::string> seen;
+            for (auto codec : Codecs::GetAll())
+            {
+                std::string extensions = codec->GetExtensions();
+                if (extensions.empty() || std::find(seen.begin(), seen.end(), extensions) != seen.end())
+                    continue;
+
+                seen.push_back(extensions);
+                allExtensions += (allExtensions.empty() ? "" : ",") + extensions;
+                patterns.push_back({ codec->GetDescription(), codec->GetExtensions() });
+            }
+
+            patterns.insert(patterns.begin(), { "Palette Files", allExtensions.c_str() });
+        }
+
+        return patterns;
+    }
+
+    const std::vector<nfdfilteritem_t> &GetFilterPatterns(fs::FileType type)
+    {
+        static const std::vector<nfdfilteritem_t> macroPatterns = { { "Palette Macros", Macro::Extension } };
+        static const std::vector<nfdfilteritem_t> textPatterns = { { "Text Files", "txt,log" } };
+        static const std::vector<nfdfilteritem_t> tracePatterns = { { "Chrome Traces", "json" } };
+
+        switch (type)
+        {
+        case fs::FileType::Macro: return macroPatterns;
+        case fs::FileType::Text: return textPatterns;
+        case fs::FileType::Trace: return tracePatterns;
+        default: return GetFilterPatterns();
+        }
+    }
 }
 
 namespace fs
@@ -14,10 +57,17 @@ namespace fs
         return std::filesystem::path(path).filename().string();
     }
 
-    bool OpenFilePrompt(PromptCallback cb, const char *defaultPath)
+    bool Exists(const std::string &path)
+    {
+        std::error_code ec;
+        return std::filesystem::exists(path, ec);
+    }
+
+    bool OpenFilePrompt(PromptCallback cb, const char *defaultPath, FileType type)
     {
+        const auto &patterns = GetFilterPatterns(type);
         const nfdpathset_t *paths;
-        nfdresult_t result = NFD_OpenDialogMultipleU8(&paths, sFilterPatterns, 1, nullptr);
+        nfdresult_t result = NFD_OpenDialogMultipleU8(&paths, patterns.data(), patterns.size(), nullptr);
 
         if (result == NFD_OKAY)
         {
@@ -38,10 +88,11 @@ namespace fs
         return false;
     }
 
-    bool SaveFilePrompt(PromptCallback cb)
+    bool SaveFilePrompt(PromptCallback cb, FileType type)
     {
+        const auto &patterns = GetFilterPatterns(type);
         char *path;
-        nfdresult_t result = NFD_SaveDialog(&path, sFilterPatterns, 1, 0, 0);
+        nfdresult_t result = NFD_SaveDialog(&path, patterns.data(), patterns.size(), 0, 0);
 
         if (result == NFD_OKAY)
         {
@@ -0,0 +1,249 @@
+#include "io.hpp"
+#include <utility>
+#include <filesystem>
+#include <system_error>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <atomic>
+#else
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+namespace io
+{
+    MappedFile::MappedFile(const std::string &fname)
+    {
+        Open(fname);
+    }
+
+    MappedFile::~MappedFile()
+    {
+        Close();
+    }
+
+    MappedFile::MappedFile(MappedFile &&other) noexcept
+    {
+        *this = std::move(other);
+    }
+
+    MappedFile &MappedFile::operator=(MappedFile &&other) noexcept
+    {
+        if (this != &other)
+        {
+            Close();
+            std::swap(m_Data, other.m_Data);
+            std::swap(m_Size, other.m_Size);
+            std::swap(m_IsOpen, other.m_IsOpen);
+#if defined(_WIN32)
+            std::swap(m_File, other.m_File);
+            std::swap(m_Mapping, other.m_Mapping);
+#endif
+        }
+        return *this;
+    }
+
+#if defined(_WIN32)
+    bool MappedFile::Open(const std::string &fname)
+    {
+        Close();
+
+        HANDLE file = CreateFileA(fname.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+            return false;
+
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file, &size))
+        {
+            CloseHandle(file);
+            return false;
+        }
+
+        m_File = file;
+        m_Size = static_cast<size_t>(size.QuadPart);
+        m_IsOpen = true;
+
+        if (m_Size == 0)
+            return true;
+
+        m_Mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (m_Mapping)
+            m_Data = static_cast<const char *>(MapViewOfFile(m_Mapping, FILE_MAP_READ, 0, 0, 0));
+
+        if (m_Data == nullptr)
+        {
+            Close();
+            return false;
+        }
+
+        return true;
+    }
+
+    void MappedFile::Close()
+    {
+        if (m_Data)
+            UnmapViewOfFile(m_Data);
+        if (m_Mapping)
+            CloseHandle(m_Mapping);
+        if (m_File)
+            CloseHandle(m_File);
+
+        m_Data = nullptr;
+        m_Mapping = nullptr;
+        m_File = nullptr;
+        m_Size = 0;
+        m_IsOpen = false;
+    }
+#else
+    bool MappedFile::Open(const std::string &fname)
+    {
+        Close();
+
+        int fd = open(fname.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+
+        struct stat st;
+        if (fstat(fd, &st) != 0)
+        {
+            close(fd);
+            return false;
+        }
+
+        m_Size = static_cast<size_t>(st.st_size);
+        m_IsOpen = true;
+
+        if (m_Size > 0)
+        {
+            void *addr = mmap(nullptr, m_Size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (addr == MAP_FAILED)
+            {
+                close(fd);
+                m_Size = 0;
+                m_IsOpen = false;
+                return false;
+            }
+
+            madvise(addr, m_Size, MADV_SEQUENTIAL);
+            m_Data = static_cast<const char *>(addr);
+        }
+
+        close(fd);
+        return true;
+    }
+
+    void MappedFile::Close()
+    {
+        if (m_Data)
+            munmap(const_cast<char *>(m_Data), m_Size);
+
+        m_Data = nullptr;
+        m_Size = 0;
+        m_IsOpen = false;
+    }
+#endif
+
+    // Both variants create a new file next to fname that no other writer
+    // can pick, so concurrent saves of the same file never share it.
+    // tmpName is left empty when nothing was created.
+#if defined(_WIN32)
+    static bool WriteTempFile(const std::string &fname, std::span<const char> data, std::string &tmpName)
+    {
+        static std::atomic<unsigned> s_Counter = 0;
+
+        HANDLE file = INVALID_HANDLE_VALUE;
+        for (int attempt = 0; attempt < 100 && file == INVALID_HANDLE_VALUE; ++attempt)
+        {
+            tmpName = fname + "." + std::to_string(GetCurrentProcessId()) + "-" + std::to_string(s_Counter++) + ".tmp";
+            file = CreateFileA(tmpName.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_NEW, FILE_ATTRIBUTE_NORMAL, nullptr);
+            if (file == INVALID_HANDLE_VALUE && GetLastError() != ERROR_FILE_EXISTS)
+                break;
+        }
+
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            tmpName.clear();
+            return false;
+        }
+
+        DWORD written = 0;
+        bool ok = WriteFile(file, data.data(), static_cast<DWORD>(data.size()), &written, nullptr) && written == data.size();
+        ok = FlushFileBuffers(file) && ok;
+        CloseHandle(file);
+        return ok;
+    }
+#else
+    static bool WriteTempFile(const std::string &fname, std::span<const char> data, std::string &tmpName)
+    {
+        tmpName = fname + ".XXXXXX";
+        int fd = mkstemp(tmpName.data());
+        if (fd < 0)
+        {
+            tmpName.clear();
+            return false;
+        }
+
+        // umask can only be read by setting it, so that is done only once.
+        static const mode_t s_Umask = [] {
+            mode_t mask = umask(0);
+            umask(mask);
+            return mask;
+        }();
+
+        // mkstemp creates the file as 0600, the rename must not change
+        // the permissions of the file being replaced.
+        struct stat st;
+        mode_t mode = stat(fname.c_str(), &st) == 0 ? st.st_mode & 07777 : 0644 & ~s_Umask;
+        if (fchmod(fd, mode) != 0)
+        {
+            close(fd);
+            return false;
+        }
+
+        const char *cur = data.data();
+        size_t remaining = data.size();
+        while (remaining > 0)
+        {
+            ssize_t written = write(fd, cur, remaining);
+            if (written < 0)
+            {
+                close(fd);
+                return false;
+            }
+            cur += written;
+            remaining -= written;
+        }
+
+        bool ok = fsync(fd) == 0;
+        return close(fd) == 0 && ok;
+    }
+#endif
+
+    bool WriteFileAtomic(const std::string &fname, std::span<const char> data)
+    {
+        std::string tmpName;
+        std::error_code ec;
+
+        if (!WriteTempFile(fname, data, tmpName))
+        {
+            if (!tmpName.empty())
+                std::filesystem::remove(tmpName, ec);
+            return false;
+        }
+
+        std::filesystem::rename(tmpName, fname, ec);
+        if (ec)
+        {
+            std::filesystem::remove(tmpName, ec);
+            return false;
+        }
+
+        return true;
+    }
+}
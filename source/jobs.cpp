@@ -0,0 +1,169 @@
+#include "jobs.hpp"
+#include "trace.hpp"
+#include <algorithm>
+
+namespace
+{
+    constexpr size_t NoWorker = static_cast<size_t>(-1);
+
+    // Lets Submit push onto the caller's own queue when a job spawns jobs.
+    thread_local const JobSystem *t_Pool = nullptr;
+    thread_local size_t t_WorkerIndex = NoWorker;
+}
+
+JobSystem::JobSystem(unsigned numThreads)
+{
+    for (unsigned i = 0; i < numThreads; ++i)
+        m_Queues.push_back(std::make_unique<Queue>());
+
+    for (unsigned i = 0; i < numThreads; ++i)
+        m_Workers.emplace_back(&JobSystem::WorkerLoop, this, i);
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard lock(m_SleepMutex);
+        m_Quit = true;
+    }
+    m_WakeUp.notify_all();
+
+    for (auto &worker : m_Workers)
+        worker.join();
+}
+
+JobSystem &JobSystem::Get()
+{
+    static JobSystem pool(GetDefaultThreadCount() - 1);
+    return pool;
+}
+
+unsigned JobSystem::GetDefaultThreadCount()
+{
+    return std::max(2u, std::thread::hardware_concurrency());
+}
+
+void JobSystem::Submit(Job job)
+{
+    // Nothing would ever take the job off a queue.
+    if (m_Workers.empty())
+    {
+        TRACE_SCOPE("Job");
+        job();
+        return;
+    }
+
+    size_t idx = t_Pool == this ? t_WorkerIndex : m_NextQueue++ % m_Queues.size();
+
+    m_Pending.fetch_add(1);
+    {
+        auto &queue = *m_Queues[idx];
+        std::lock_guard lock(queue.mutex);
+        queue.jobs.push_back(std::move(job));
+    }
+
+    {
+        std::lock_guard lock(m_SleepMutex);
+    }
+    m_WakeUp.notify_one();
+}
+
+bool JobSystem::TryPop(size_t self, Job &job)
+{
+    if (self != NoWorker)
+    {
+        auto &queue = *m_Queues[self];
+        std::lock_guard lock(queue.mutex);
+        if (!queue.jobs.empty())
+        {
+            job = std::move(queue.jobs.back());
+            queue.jobs.pop_back();
+            m_Pending.fetch_sub(1);
+            return true;
+        }
+    }
+
+    size_t start = self == NoWorker ? 0 : self + 1;
+    for (size_t i = 0; i < m_Queues.size(); ++i)
+    {
+        size_t victim = (start + i) % m_Queues.size();
+        if (victim == self)
+            continue;
+
+        auto &queue = *m_Queues[victim];
+        std::lock_guard lock(queue.mutex);
+        if (!queue.jobs.empty())
+        {
+            job = std::move(queue.jobs.front());
+            queue.jobs.pop_front();
+            m_Pending.fetch_sub(1);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void JobSystem::WorkerLoop(size_t idx)
+{
+    t_Pool = this;
+    t_WorkerIndex = idx;
+    Trace::SetThreadName(("Worker " + std::to_string(idx)).c_str());
+
+    Job job;
+    while (true)
+    {
+        if (TryPop(idx, job))
+        {
+            TRACE_SCOPE("Job");
+            job();
+            job = nullptr;
+            continue;
+        }
+
+        std::unique_lock lock(m_SleepMutex);
+        m_WakeUp.wait(lock, [this]() { return m_Quit || m_Pending.load() > 0; });
+        if (m_Quit)
+            return;
+    }
+}
+
+// The calling thread only runs calls from this batch, never other queued
+// jobs: it is often the UI thread, and picking up a whole file load there
+// would stall the frame. Workers get one job each that keeps claiming
+// indices, so the batch still spreads out over the free ones.
+void JobSystem::ParallelFor(size_t count, const std::function<void(size_t)> &body)
+{
+    if (count == 0)
+        return;
+
+    // On the heap: a helper that starts late still claims an index, and
+    // the last one may be notifying after this function has returned.
+    struct Batch
+    {
+        std::atomic<size_t> next = 0;
+        std::atomic<size_t> remaining;
+    };
+    auto batch = std::make_shared<Batch>();
+    batch->remaining = count;
+
+    // body is only touched for claimed indices, which all finish before
+    // this function returns.
+    auto run = [&body, count](Batch &batch) {
+        for (size_t i; (i = batch.next.fetch_add(1)) < count;)
+        {
+            body(i);
+            if (batch.remaining.fetch_sub(1) == 1)
+                batch.remaining.notify_all();
+        }
+    };
+
+    size_t numHelpers = std::min(count - 1, m_Workers.size());
+    for (size_t i = 0; i < numHelpers; ++i)
+        Submit([batch, run]() { run(*batch); });
+
+    run(*batch);
+
+    for (size_t left; (left = batch->remaining.load()) != 0;)
+        batch->remaining.wait(left);
+}
@@ -0,0 +1,395 @@
+#include "journal.hpp"
+#include "io.hpp"
+#include <cstring>
+
+static constexpr char sText_JournalMagic[8] = { 'P', 'A', 'L', 'J', 'R', 'N', 'L', '1' };
+
+namespace
+{
+    constexpr size_t HeaderSize = 32;
+    constexpr size_t EntrySize = 16;
+    // Entry types below this are HistoryEvent::Type values.
+    constexpr uint8_t SavedEntry = 0x40;
+
+    // All numbers are stored little endian, whatever the host is.
+    void PutU32(char *out, uint32_t v)
+    {
+        for (int i = 0; i < 4; ++i)
+            out[i] = static_cast<char>(v >> (8 * i));
+    }
+
+    uint32_t GetU32(const char *in)
+    {
+        uint32_t v = 0;
+        for (int i = 0; i < 4; ++i)
+            v |= static_cast<uint32_t>(static_cast<uint8_t>(in[i])) << (8 * i);
+        return v;
+    }
+
+    void AppendU64(std::string &out, uint64_t v)
+    {
+        char bytes[8];
+        PutU32(bytes, static_cast<uint32_t>(v));
+        PutU32(bytes + 4, static_cast<uint32_t>(v >> 32));
+        out.append(bytes, 8);
+    }
+
+    uint64_t GetU64(const char *in)
+    {
+        return GetU32(in) | (static_cast<uint64_t>(GetU32(in + 4)) << 32);
+    }
+
+    uint32_t PackRGB(const Color &color) { return color.r | (color.g << 8) | (color.b << 16); }
+    Color UnpackRGB(uint32_t v) { return { static_cast<uint8_t>(v), static_cast<uint8_t>(v >> 8), static_cast<uint8_t>(v >> 16) }; }
+
+    uint32_t PackTransform(const Transform &t)
+    {
+        return static_cast<uint8_t>(t.type) | (static_cast<uint8_t>(t.a) << 8) | (static_cast<uint8_t>(t.b) << 16) | (static_cast<uint32_t>(static_cast<uint8_t>(t.c)) << 24);
+    }
+
+    Transform UnpackTransform(uint32_t v)
+    {
+        return { static_cast<Transform::Type>(v & 0xFF), static_cast<int8_t>(v >> 8), static_cast<int8_t>(v >> 16), static_cast<int8_t>(v >> 24) };
+    }
+
+    void AppendColors(std::string &out, const Color *colors, size_t count)
+    {
+        for (size_t i = 0; i < count; ++i)
+            out.append({ static_cast<char>(colors[i].r), static_cast<char>(colors[i].g), static_cast<char>(colors[i].b), 0 });
+    }
+
+    void EncodeEntry(char *out, uint8_t type, const ActionRecord &record, bool joined)
+    {
+        std::memset(out, 0, EntrySize);
+        out[0] = static_cast<char>(type);
+        out[1] = static_cast<char>(record.index());
+        out[2] = joined;
+
+        std::visit([out](const auto &action) {
+            using T = std::decay_t<decltype(action)>;
+            if constexpr (std::is_same_v<T, Actions::ModifyColor>)
+            {
+                PutU32(out + 4, action.index);
+                PutU32(out + 8, PackRGB(action.oldColor));
+                PutU32(out + 12, PackRGB(action.newColor));
+            }
+            else if constexpr (std::is_same_v<T, Actions::SwapColors>)
+            {
+                PutU32(out + 4, action.first);
+                PutU32(out + 8, action.second);
+            }
+            else if constexpr (std::is_same_v<T, Actions::ChangeColorCount>)
+            {
+                PutU32(out + 4, action.oldSize);
+                PutU32(out + 8, action.newSize);
+            }
+            else
+            {
+                PutU32(out + 4, action.begin);
+                PutU32(out + 8, action.count);
+                PutU32(out + 12, PackTransform(action.transform));
+            }
+        }, record);
+    }
+
+    bool DecodeRecord(const char *in, ActionRecord &record)
+    {
+        uint32_t a = GetU32(in + 4), b = GetU32(in + 8), c = GetU32(in + 12);
+
+        switch (in[1])
+        {
+        case 0:
+            record = Actions::ModifyColor(a, UnpackRGB(b), UnpackRGB(c));
+            return true;
+        case 1:
+            record = Actions::SwapColors(a, b);
+            return true;
+        case 2:
+            record = Actions::ChangeColorCount(a, b);
+            return a <= Palette::MaxColors && b <= Palette::MaxColors;
+        case 3:
+            record = Actions::TransformColors(a, b, UnpackTransform(c));
+            return (c & 0xFF) < static_cast<uint32_t>(Transform::Type::Count);
+        }
+        return false;
+    }
+
+    // Guards replay against damaged entries writing outside the palette.
+    bool FitsPalette(const ActionRecord &record, const Palette &palette)
+    {
+        if (auto edit = std::get_if<Actions::ModifyColor>(&record))
+            return edit->index < palette.size();
+        if (auto swap = std::get_if<Actions::SwapColors>(&record))
+            return swap->first < palette.size() && swap->second < palette.size();
+        if (auto transform = std::get_if<Actions::TransformColors>(&record))
+            return transform->begin <= palette.size() && transform->count <= palette.size() - transform->begin;
+        return std::get<Actions::ChangeColorCount>(record).oldSize == palette.size();
+    }
+
+    uint64_t HashBytes(const char *data, size_t size)
+    {
+        uint64_t hash = 0xCBF29CE484222325ULL;
+        for (size_t i = 0; i < size; ++i)
+            hash = (hash ^ static_cast<uint8_t>(data[i])) * 0x100000001B3ULL;
+        return hash;
+    }
+
+    class Reader
+    {
+    public:
+        Reader(const char *data, size_t size) : m_Data(data), m_Size(size) { }
+
+        bool Read(size_t size, const char *&out)
+        {
+            if (size > m_Size - m_Pos)
+                return false;
+            out = m_Data + m_Pos;
+            m_Pos += size;
+            return true;
+        }
+
+        bool ReadU64(uint64_t &v)
+        {
+            const char *p;
+            if (!Read(8, p))
+                return false;
+            v = GetU64(p);
+            return true;
+        }
+
+        bool ReadColors(size_t count, Color *out)
+        {
+            const char *p;
+            if (count > (m_Size - m_Pos) / 4 || !Read(count * 4, p))
+                return false;
+            for (size_t i = 0; i < count; ++i)
+                out[i] = { static_cast<uint8_t>(p[i * 4]), static_cast<uint8_t>(p[i * 4 + 1]), static_cast<uint8_t>(p[i * 4 + 2]) };
+            return true;
+        }
+    private:
+        const char *m_Data;
+        size_t m_Size, m_Pos = 0;
+    };
+
+    void AppendHistory(std::string &out, const ActionRegister::State &state)
+    {
+        AppendU64(out, state.records.size());
+        AppendU64(out, state.cursor);
+        for (size_t i = 0; i < state.records.size(); ++i)
+        {
+            char entry[EntrySize];
+            EncodeEntry(entry, static_cast<uint8_t>(HistoryEvent::Type::Push), state.records[i], state.joined[i]);
+            out.append(entry, EntrySize);
+        }
+
+        AppendU64(out, state.removed.size());
+        AppendU64(out, state.removedCursor);
+        AppendColors(out, state.removed.data(), state.removed.size());
+    }
+
+    bool ReadHistory(Reader &reader, ActionRegister::State &state)
+    {
+        uint64_t recordCount, cursor, removedCount, removedCursor;
+
+        if (!reader.ReadU64(recordCount) || !reader.ReadU64(cursor) || cursor > recordCount)
+            return false;
+
+        const char *entries;
+        if (recordCount > SIZE_MAX / EntrySize || !reader.Read(recordCount * EntrySize, entries))
+            return false;
+
+        state.records.resize(recordCount, Actions::SwapColors(0, 0));
+        state.joined.resize(recordCount);
+        state.cursor = cursor;
+        for (size_t i = 0; i < recordCount; ++i)
+        {
+            if (!DecodeRecord(entries + i * EntrySize, state.records[i]))
+                return false;
+            state.joined[i] = entries[i * EntrySize + 2] != 0;
+        }
+
+        if (!reader.ReadU64(removedCount) || !reader.ReadU64(removedCursor) || removedCursor > removedCount || removedCount > SIZE_MAX / 4)
+            return false;
+
+        state.removed.resize(removedCount);
+        state.removedCursor = removedCursor;
+        return reader.ReadColors(removedCount, state.removed.data());
+    }
+
+    bool ReadCheckpoint(Reader &reader, Palette &palette, ActionRegister::State &state)
+    {
+        uint64_t paletteSize;
+
+        if (!reader.ReadU64(paletteSize) || paletteSize > Palette::MaxColors)
+            return false;
+
+        palette.resize(paletteSize);
+        for (size_t i = 0; i < palette.GetChunkCount(); ++i)
+        {
+            auto chunk = palette.GetChunk(i);
+            if (!reader.ReadColors(chunk.size(), chunk.data()))
+                return false;
+        }
+
+        return ReadHistory(reader, state);
+    }
+}
+
+Journal::~Journal()
+{
+    Close();
+}
+
+bool Journal::Restore(const std::string &paletteFile, uint64_t fileHash, Palette &palette, ActionRegister &actions)
+{
+    io::MappedFile file(GetPath(paletteFile));
+    if (!file.IsOpen() || file.size() < HeaderSize || std::memcmp(file.data(), sText_JournalMagic, sizeof(sText_JournalMagic)) != 0)
+        return false;
+
+    const char *data = file.data();
+    uint64_t savedHash = GetU64(data + 8);
+    uint64_t checkpointSize = GetU64(data + 16);
+    if (checkpointSize > file.size() - HeaderSize || HashBytes(data + HeaderSize, checkpointSize) != GetU64(data + 24))
+        return false;
+
+    // A torn last entry from a crash is simply ignored.
+    size_t entriesBegin = HeaderSize + checkpointSize;
+    size_t numEntries = (file.size() - entriesBegin) / EntrySize;
+
+    for (size_t i = 0; i < numEntries; ++i)
+    {
+        const char *entry = data + entriesBegin + i * EntrySize;
+        if (static_cast<uint8_t>(entry[0]) == SavedEntry)
+            savedHash = GetU32(entry + 4) | (static_cast<uint64_t>(GetU32(entry + 8)) << 32);
+    }
+
+    if (savedHash != fileHash)
+        return false;
+
+    Palette restored;
+    ActionRegister::State state;
+    Reader reader(data + HeaderSize, checkpointSize);
+    if (!ReadCheckpoint(reader, restored, state))
+        return false;
+
+    palette = std::move(restored);
+    actions.SetState(std::move(state));
+
+    for (size_t i = 0; i < numEntries; ++i)
+    {
+        const char *entry = data + entriesBegin + i * EntrySize;
+        uint8_t type = static_cast<uint8_t>(entry[0]);
+        if (type == SavedEntry)
+            continue;
+        if (type > static_cast<uint8_t>(HistoryEvent::Type::ClearUndo))
+            break;
+
+        HistoryEvent event{ static_cast<HistoryEvent::Type>(type) };
+        if (event.type == HistoryEvent::Type::Push || event.type == HistoryEvent::Type::Amend)
+        {
+            if (!DecodeRecord(entry, event.record) || !FitsPalette(event.record, palette))
+                break;
+        }
+
+        actions.Replay(event);
+    }
+
+    // The app went away in the middle of a transaction.
+    if (actions.InTransaction())
+        actions.RollbackTransaction();
+
+    return true;
+}
+
+void Journal::SaveHistory(std::string &out, const ActionRegister::State &state)
+{
+    AppendHistory(out, state);
+}
+
+bool Journal::LoadHistory(std::span<const char> data, ActionRegister::State &state)
+{
+    Reader reader(data.data(), data.size());
+    return ReadHistory(reader, state);
+}
+
+bool Journal::Open(const std::string &paletteFile, uint64_t savedHash)
+{
+    Close();
+
+    m_PaletteFile = paletteFile;
+    m_SavedHash = savedHash;
+    return Checkpoint();
+}
+
+void Journal::Close()
+{
+    if (m_File)
+        std::fclose(m_File);
+    m_File = nullptr;
+}
+
+bool Journal::Checkpoint()
+{
+    if (m_PaletteFile.empty() || m_Actions.InTransaction())
+        return false;
+
+    std::string buffer(HeaderSize, '\0');
+
+    AppendU64(buffer, m_Palette.size());
+    for (size_t i = 0; i < m_Palette.GetChunkCount(); ++i)
+    {
+        auto chunk = m_Palette.GetChunk(i);
+        AppendColors(buffer, chunk.data(), chunk.size());
+    }
+
+    AppendHistory(buffer, m_Actions.GetState());
+
+    std::string header(sText_JournalMagic, sizeof(sText_JournalMagic));
+    AppendU64(header, m_SavedHash);
+    AppendU64(header, buffer.size() - HeaderSize);
+    AppendU64(header, HashBytes(buffer.data() + HeaderSize, buffer.size() - HeaderSize));
+    buffer.replace(0, HeaderSize, header);
+
+    Close();
+
+    auto path = GetPath(m_PaletteFile);
+    if (!io::WriteFileAtomic(path, buffer))
+        return false;
+
+    m_File = std::fopen(path.c_str(), "ab");
+    m_NumEntries = 0;
+    return m_File != nullptr;
+}
+
+void Journal::WriteEntry(const char *entry)
+{
+    if (!m_File)
+        return;
+
+    std::fwrite(entry, 1, EntrySize, m_File);
+
+    // Transactions are flushed once, when they are done.
+    if (!m_Actions.InTransaction())
+        std::fflush(m_File);
+}
+
+void Journal::Append(const HistoryEvent &event)
+{
+    char entry[EntrySize];
+    EncodeEntry(entry, static_cast<uint8_t>(event.type), event.record, false);
+    WriteEntry(entry);
+
+    if (++m_NumEntries >= CheckpointInterval && !m_Actions.InTransaction())
+        Checkpoint();
+}
+
+void Journal::MarkSaved(uint64_t hash)
+{
+    char entry[EntrySize] = {};
+    entry[0] = static_cast<char>(SavedEntry);
+    PutU32(entry + 4, static_cast<uint32_t>(hash));
+    PutU32(entry + 8, static_cast<uint32_t>(hash >> 32));
+
+    m_SavedHash = hash;
+    WriteEntry(entry);
+}
@@ -0,0 +1,272 @@
+#include "macro.hpp"
+#include "codecs.hpp"
+#include "io.hpp"
+#include "text_scanner.hpp"
+#include <utility>
+#include <cstdio>
+
+static constexpr char sText_MacroHeader[] = "palette-macro 1";
+
+static bool ReadParameters(TextScanner &tokens, int8_t *params)
+{
+    for (int i = 0; i < 3; ++i)
+    {
+        long value;
+        if (!tokens.NextInt(value) || value < -128 || value > 127)
+            return false;
+        params[i] = static_cast<int8_t>(value);
+    }
+    return true;
+}
+
+void Macro::Observe(const HistoryEvent &event)
+{
+    switch (event.type)
+    {
+    case HistoryEvent::Type::Push:
+        // Records after the first of a transaction belong to its step.
+        if (m_TransactionDepth == 0 || !m_TransactionHasStep)
+        {
+            m_UndoneSteps.clear();
+            m_StepBegin.push_back(m_Actions.size());
+            m_TransactionHasStep = m_TransactionDepth > 0;
+        }
+        m_Actions.push_back(event.record);
+        break;
+    case HistoryEvent::Type::Amend:
+        if (!m_Actions.empty() && std::holds_alternative<Actions::ModifyColor>(m_Actions.back()))
+            std::get<Actions::ModifyColor>(m_Actions.back()).newColor = std::get<Actions::ModifyColor>(event.record).newColor;
+        break;
+    case HistoryEvent::Type::Undo:
+        // Undoing past the start of the recording leaves the macro alone.
+        if (!m_StepBegin.empty())
+        {
+            auto begin = m_Actions.begin() + m_StepBegin.back();
+            m_UndoneSteps.emplace_back(begin, m_Actions.end());
+            m_Actions.erase(begin, m_Actions.end());
+            m_StepBegin.pop_back();
+        }
+        break;
+    case HistoryEvent::Type::Redo:
+        if (!m_UndoneSteps.empty())
+        {
+            m_StepBegin.push_back(m_Actions.size());
+            m_Actions.insert(m_Actions.end(), m_UndoneSteps.back().begin(), m_UndoneSteps.back().end());
+            m_UndoneSteps.pop_back();
+        }
+        break;
+    case HistoryEvent::Type::BeginTransaction:
+        if (m_TransactionDepth++ == 0)
+            m_TransactionHasStep = false;
+        break;
+    case HistoryEvent::Type::CommitTransaction:
+        if (m_TransactionDepth > 0)
+            --m_TransactionDepth;
+        break;
+    case HistoryEvent::Type::RollbackTransaction:
+        if (m_TransactionHasStep && !m_StepBegin.empty())
+        {
+            m_Actions.erase(m_Actions.begin() + m_StepBegin.back(), m_Actions.end());
+            m_StepBegin.pop_back();
+        }
+        m_TransactionDepth = 0;
+        m_TransactionHasStep = false;
+        break;
+    case HistoryEvent::Type::ClearUndo:
+        break;
+    }
+}
+
+void Macro::Clear()
+{
+    m_Actions.clear();
+    m_StepBegin.clear();
+    m_UndoneSteps.clear();
+    m_TransactionDepth = 0;
+    m_TransactionHasStep = false;
+}
+
+size_t Macro::ApplyTo(Palette &palette) const
+{
+    size_t skipped = 0;
+
+    for (const auto &record : m_Actions)
+    {
+        if (auto edit = std::get_if<Actions::ModifyColor>(&record))
+        {
+            if (edit->index < palette.size())
+                palette[edit->index] = edit->newColor;
+            else
+                ++skipped;
+        }
+        else if (auto swap = std::get_if<Actions::SwapColors>(&record))
+        {
+            if (swap->first < palette.size() && swap->second < palette.size())
+                std::swap(palette[swap->first], palette[swap->second]);
+            else
+                ++skipped;
+        }
+        else if (auto transform = std::get_if<Actions::TransformColors>(&record))
+        {
+            if (transform->begin < palette.size())
+                transform->transform.Apply(palette, transform->begin, std::min<size_t>(transform->count, palette.size() - transform->begin));
+            else
+                ++skipped;
+        }
+        else
+        {
+            palette.resize(std::get<Actions::ChangeColorCount>(record).newSize);
+        }
+    }
+
+    return skipped;
+}
+
+size_t Macro::ApplyTo(Palette &palette, ActionRegister &actions) const
+{
+    size_t skipped = 0;
+
+    // The records are rebuilt against the target, so undo brings back the
+    // target's own colors.
+    actions.BeginTransaction();
+    for (const auto &record : m_Actions)
+    {
+        if (auto edit = std::get_if<Actions::ModifyColor>(&record))
+        {
+            if (edit->index < palette.size())
+                actions.RegisterAction<Actions::ModifyColor>(edit->index, std::as_const(palette)[edit->index], edit->newColor);
+            else
+                ++skipped;
+        }
+        else if (auto swap = std::get_if<Actions::SwapColors>(&record))
+        {
+            if (swap->first < palette.size() && swap->second < palette.size())
+                actions.RegisterAction<Actions::SwapColors>(swap->first, swap->second);
+            else
+                ++skipped;
+        }
+        else if (auto transform = std::get_if<Actions::TransformColors>(&record))
+        {
+            if (transform->begin < palette.size())
+                actions.RegisterAction<Actions::TransformColors>(transform->begin, std::min<size_t>(transform->count, palette.size() - transform->begin), transform->transform);
+            else
+                ++skipped;
+        }
+        else
+        {
+            size_t newSize = std::get<Actions::ChangeColorCount>(record).newSize;
+            if (newSize != palette.size())
+                actions.RegisterAction<Actions::ChangeColorCount>(palette.size(), newSize);
+        }
+    }
+    actions.CommitTransaction();
+
+    return skipped;
+}
+
+std::string Macro::ApplyToFile(const std::string &fname) const
+{
+    std::string buffer;
+
+    try
+    {
+        io::MappedFile file(fname);
+        if (!file.IsOpen())
+            return "Could not open file.";
+
+        auto data = file.GetSpan();
+        auto codec = Codecs::Detect(data, data.size(), fname);
+        if (!codec)
+            return "Unrecognized palette format.";
+
+        Palette palette;
+        codec->Decode(palette, data);
+        ApplyTo(palette);
+        codec->Encode(palette, buffer);
+    }
+    catch (const char *e)
+    {
+        return e;
+    }
+    catch (const std::exception &e)
+    {
+        return e.what();
+    }
+
+    if (!io::WriteFileAtomic(fname, buffer))
+        return "Could not write the palette file.";
+
+    return {};
+}
+
+bool Macro::Load(const std::string &fname)
+{
+    io::MappedFile file(fname);
+    if (!file.IsOpen())
+        return false;
+
+    TextScanner scanner(file.GetSpan());
+    if (scanner.NextLine() != sText_MacroHeader)
+        return false;
+
+    std::vector<ActionRecord> actions;
+    while (!scanner.AtEnd())
+    {
+        auto line = scanner.NextLine();
+        TextScanner tokens({ line.data(), line.size() });
+
+        auto name = tokens.NextToken();
+        if (name.empty())
+            continue;
+
+        long v[4] = {};
+        int8_t params[3];
+        auto readInts = [&tokens, &v](int count) {
+            for (int i = 0; i < count; ++i)
+            {
+                if (!tokens.NextInt(v[i]) || v[i] < 0)
+                    return false;
+            }
+            return true;
+        };
+
+        if (name == "set" && readInts(4) && v[0] < (long)Palette::MaxColors && v[1] <= 255 && v[2] <= 255 && v[3] <= 255)
+            actions.push_back(Actions::ModifyColor(v[0], Color{}, Color{ (uint8_t)v[1], (uint8_t)v[2], (uint8_t)v[3] }));
+        else if (name == "swap" && readInts(2) && v[0] < (long)Palette::MaxColors && v[1] < (long)Palette::MaxColors)
+            actions.push_back(Actions::SwapColors(v[0], v[1]));
+        else if (name == "resize" && readInts(1) && v[0] > 0 && v[0] <= (long)Palette::MaxColors)
+            actions.push_back(Actions::ChangeColorCount(0, v[0]));
+        else if (name == "transform" && readInts(3) && v[0] < (long)Transform::Type::Count && v[1] < (long)Palette::MaxColors &&
+            v[2] <= (long)Palette::MaxColors && ReadParameters(tokens, params))
+            actions.push_back(Actions::TransformColors(v[1], v[2], { (Transform::Type)v[0], params[0], params[1], params[2] }));
+        else
+            return false;
+    }
+
+    Clear();
+    m_Actions = std::move(actions);
+    return true;
+}
+
+bool Macro::Save(const std::string &fname) const
+{
+    std::string buffer = sText_MacroHeader;
+    buffer += '\n';
+
+    char line[64];
+    for (const auto &record : m_Actions)
+    {
+        if (auto edit = std::get_if<Actions::ModifyColor>(&record))
+            std::snprintf(line, sizeof(line), "set %u %u %u %u\n", edit->index, edit->newColor.r, edit->newColor.g, edit->newColor.b);
+        else if (auto swap = std::get_if<Actions::SwapColors>(&record))
+            std::snprintf(line, sizeof(line), "swap %u %u\n", swap->first, swap->second);
+        else if (auto transform = std::get_if<Actions::TransformColors>(&record))
+            std::snprintf(line, sizeof(line), "transform %u %u %u %d %d %d\n", static_cast<unsigned>(transform->transform.type), transform->begin, transform->count,
+                transform->transform.a, transform->transform.b, transform->transform.c);
+        else
+            std::snprintf(line, sizeof(line), "resize %u\n", std::get<Actions::ChangeColorCount>(record).newSize);
+        buffer += line;
+    }
+
+    return io::WriteFileAtomic(fname, buffer);
+}
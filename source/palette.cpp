@@ -1,88 +1,336 @@
 #include "palette.hpp"
-
-static constexpr char sText_JASC_PAL[] = "JASC-PAL";
-static constexpr char sText_PAL_0100[] = "0100";
+#include "io.hpp"
+#include "bgr555.hpp"
+#include "codecs.hpp"
+#include "trace.hpp"
+#include <cstring>
 
 Palette::Palette()
 {
-    m_Colors.resize(0);
 }
 
 Palette::Palette(size_t i)
 {
-    m_Colors.assign(i, { 0.0f, 0.0f, 0.0f });
+    resize(i);
 }
 
-void Palette::LoadFromFile(const std::string &fname)
+void Palette::resize(size_t size)
+{
+    size_t numChunks = (size + ChunkSize - 1) / ChunkSize;
+
+    if (size < m_Size && size % ChunkSize != 0)
+    {
+        // Slots past the end of the last chunk are kept black so growing
+        // the palette again does not bring back old colors.
+        auto &last = MutableChunk(numChunks - 1);
+        std::fill(last.begin() + size % ChunkSize, last.end(), Color{ 0, 0, 0 });
+    }
+
+    size_t oldChunks = m_Chunks.size();
+    m_Chunks.resize(numChunks);
+    for (size_t i = oldChunks; i < numChunks; ++i)
+        m_Chunks[i] = std::make_shared<Chunk>();
+
+    m_Size = size;
+}
+
+void Palette::clear()
+{
+    m_Chunks.clear();
+    m_Size = 0;
+}
+
+void Palette::push_back(const Color &color)
+{
+    resize(m_Size + 1);
+    (*this)[m_Size - 1] = color;
+}
+
+void Palette::CopyTo(size_t begin, size_t count, Color *out) const
+{
+    while (count > 0)
+    {
+        size_t offset = begin % ChunkSize;
+        size_t n = std::min(count, ChunkSize - offset);
+        std::memcpy(out, m_Chunks[begin / ChunkSize]->data() + offset, n * sizeof(Color));
+        out += n;
+        begin += n;
+        count -= n;
+    }
+}
+
+void Palette::CopyFrom(size_t begin, size_t count, const Color *in)
+{
+    while (count > 0)
+    {
+        size_t offset = begin % ChunkSize;
+        size_t n = std::min(count, ChunkSize - offset);
+        std::memcpy(MutableChunk(begin / ChunkSize).data() + offset, in, n * sizeof(Color));
+        in += n;
+        begin += n;
+        count -= n;
+    }
+}
+
+void Palette::operator+=(const Palette &other)
+{
+    if (this == &other)
+    {
+        Palette copy = other;
+        *this += copy;
+        return;
+    }
+
+    size_t offset = m_Size;
+    if (offset % ChunkSize == 0)
+    {
+        // The last chunk of other is black past its end, so it can be
+        // shared as well.
+        m_Chunks.insert(m_Chunks.end(), other.m_Chunks.begin(), other.m_Chunks.end());
+        m_Size += other.m_Size;
+        return;
+    }
+
+    resize(m_Size + other.m_Size);
+    for (size_t i = 0; i < other.GetChunkCount(); ++i)
+    {
+        auto chunk = other.GetChunk(i);
+        CopyFrom(offset, chunk.size(), chunk.data());
+        offset += chunk.size();
+    }
+}
+
+Palette Palette::Slice(size_t begin, size_t count) const
+{
+    Palette slice;
+    // begin may be size(), past the last chunk.
+    if (count == 0)
+        return slice;
+
+    if (begin % ChunkSize == 0)
+    {
+        size_t first = begin / ChunkSize;
+        size_t numFull = count / ChunkSize;
+        slice.m_Chunks.assign(m_Chunks.begin() + first, m_Chunks.begin() + first + numFull);
+        slice.m_Size = numFull * ChunkSize;
+        begin += slice.m_Size;
+        count -= slice.m_Size;
+    }
+
+    // A partly used chunk is copied, its tail has to be black.
+    size_t offset = slice.m_Size;
+    slice.resize(offset + count);
+    while (count > 0)
+    {
+        size_t n = std::min(count, ChunkSize - begin % ChunkSize);
+        slice.CopyFrom(offset, n, m_Chunks[begin / ChunkSize]->data() + begin % ChunkSize);
+        offset += n;
+        begin += n;
+        count -= n;
+    }
+
+    return slice;
+}
+
+void Palette::Paste(size_t begin, const Palette &source)
 {
-    std::ifstream stream(fname);
-    if (stream.is_open())
-        LoadFromFile(stream);
-    stream.close();
+    for (size_t i = 0; i < source.GetChunkCount(); ++i)
+    {
+        auto chunk = source.GetChunk(i);
+        if (begin % ChunkSize == 0 && chunk.size() == ChunkSize)
+            m_Chunks[begin / ChunkSize] = source.m_Chunks[i];
+        else
+            CopyFrom(begin, chunk.size(), chunk.data());
+        begin += chunk.size();
+    }
+}
+
+bool Palette::operator==(const Palette &other) const
+{
+    if (m_Size != other.m_Size)
+        return false;
+
+    for (size_t i = 0; i < m_Chunks.size(); ++i)
+    {
+        if (m_Chunks[i] == other.m_Chunks[i])
+            continue;
+
+        auto a = GetChunk(i), b = other.GetChunk(i);
+        if (!std::equal(a.begin(), a.end(), b.begin()))
+            return false;
+    }
+
+    return true;
+}
+
+size_t Palette::GetSharedChunkCount() const
+{
+    size_t shared = 0;
+    for (const auto &chunk : m_Chunks)
+        shared += chunk.use_count() > 1;
+    return shared;
+}
+
+size_t Palette::GetMemoryUsage() const
+{
+    size_t bytes = m_Chunks.capacity() * sizeof(m_Chunks[0]);
+    for (const auto &chunk : m_Chunks)
+        bytes += sizeof(Chunk) / chunk.use_count();
+    return bytes;
 }
 
-void Palette::LoadFromFile(std::ifstream &stream)
+// Each block starts with a control byte: below 128 it is followed by
+// control + 1 literal colors, otherwise by one color repeated control - 126
+// times.
+void Palette::Compress(std::string &out) const
 {
-    std::vector<Color> new_colors;
-    std::string line;
+    out.clear();
+    for (int i = 0; i < 4; ++i)
+        out += static_cast<char>(m_Size >> (8 * i));
+
+    auto appendColor = [&out](const Color &color) {
+        out.append({ static_cast<char>(color.r), static_cast<char>(color.g), static_cast<char>(color.b) });
+    };
+
+    const auto &colors = *this;
+    for (size_t i = 0; i < m_Size;)
+    {
+        size_t run = 1;
+        while (i + run < m_Size && run < 129 && colors[i + run] == colors[i])
+            ++run;
+
+        if (run >= 2)
+        {
+            out += static_cast<char>(run + 126);
+            appendColor(colors[i]);
+            i += run;
+            continue;
+        }
+
+        size_t end = i + 1;
+        while (end < m_Size && end - i < 128 && !(end + 1 < m_Size && colors[end + 1] == colors[end]))
+            ++end;
 
-    uint16_t num_colors;
-    int r, g, b;
+        out += static_cast<char>(end - i - 1);
+        for (; i < end; ++i)
+            appendColor(colors[i]);
+    }
+}
 
-    stream >> line;
-    if (line != sText_JASC_PAL) 
-        throw ("Invalid JASC-PAL signature.");
+bool Palette::Decompress(std::span<const char> data)
+{
+    if (data.size() < 4)
+        return false;
 
-    stream >> line;
-    if (line != sText_PAL_0100) 
-        throw ("Unsupported JASC-PAL version.");
+    size_t size = 0;
+    for (int i = 0; i < 4; ++i)
+        size |= static_cast<size_t>(static_cast<uint8_t>(data[i])) << (8 * i);
+    if (size > MaxColors)
+        return false;
 
-    if (!(stream >> num_colors))
-        throw ("Could not parse number of colors.");
+    resize(size);
 
-    if (num_colors < 1 || num_colors > 256)
-        throw ("Unsupported number of colors. (Color count must be between 1 and 256)");
+    std::span<Color> chunk;
+    auto put = [this, &chunk](size_t idx, const Color &color) {
+        if (idx % ChunkSize == 0)
+            chunk = GetChunk(idx / ChunkSize);
+        chunk[idx % ChunkSize] = color;
+    };
+    auto colorAt = [&data](size_t pos) {
+        return Color{ static_cast<uint8_t>(data[pos]), static_cast<uint8_t>(data[pos + 1]), static_cast<uint8_t>(data[pos + 2]) };
+    };
 
-    for (int i = 0; i < num_colors; i++)
+    size_t pos = 4;
+    for (size_t idx = 0; idx < size;)
     {
-        if (!(stream >> r >> g >> b))
-            throw ("Error parsing color components.");
+        if (pos >= data.size())
+            return false;
 
-        if (r < 0 || g < 0 || b < 0 || r > 255 || g > 255 || b > 255)
-            throw ("Color component value must be between 0 and 255.");
+        uint8_t control = static_cast<uint8_t>(data[pos++]);
+        bool isRun = control >= 128;
+        size_t count = isRun ? control - 126 : control + 1;
+        size_t bytes = isRun ? 3 : count * 3;
+        if (count > size - idx || bytes > data.size() - pos)
+            return false;
 
-        new_colors.push_back({ 
-            static_cast<float>(r / 255.0f), 
-            static_cast<float>(g / 255.0f), 
-            static_cast<float>(b / 255.0f) 
-        });
+        for (size_t k = 0; k < count; ++k, ++idx)
+            put(idx, colorAt(isRun ? pos : pos + k * 3));
+        pos += bytes;
     }
 
-    m_Colors = new_colors;
-    return;
+    return true;
 }
 
-void Palette::SaveToFile(const std::string &fname)
+void Palette::LoadFromFile(const std::string &fname)
+{
+    TRACE_SCOPE("Palette::LoadFromFile");
+    io::MappedFile file(fname);
+    if (!file.IsOpen())
+        return;
+
+    auto data = file.GetSpan();
+    auto codec = Codecs::Detect(data, data.size(), fname);
+    if (!codec)
+        throw ("Unrecognized palette format.");
+
+    codec->Decode(*this, data);
+}
+
+void Palette::LoadFromBuffer(std::span<const char> buffer, const Codec *codec)
 {
-    std::ofstream stream(fname);
-    if (stream.is_open())
-        SaveToFile(stream);
-    stream.close();
+    if (!codec)
+        codec = Codecs::Detect(buffer, buffer.size());
+    if (!codec)
+        throw ("Unrecognized palette format.");
+
+    codec->Decode(*this, buffer);
 }
 
-void Palette::SaveToFile(std::ofstream &stream)
+bool Palette::SaveToFile(const std::string &fname, const Codec *codec) const
 {
-    stream << sText_JASC_PAL << "\r\n";
-    stream << sText_PAL_0100 << "\r\n";
-    stream << m_Colors.size() << "\r\n";
+    TRACE_SCOPE("Palette::SaveToFile");
+    static thread_local std::string buffer;
+
+    if (!codec)
+        codec = Codecs::FindByExtension(fname);
+
+    SaveToBuffer(buffer, codec);
 
-    for (auto &color: m_Colors)
+    // Leaves the modification time alone when the file already has these
+    // bytes, so tools watching it do not rebuild for nothing.
     {
-        int r, g, b;
-        r = static_cast<uint8_t>(color[0] * 255.0f);
-        g = static_cast<uint8_t>(color[1] * 255.0f);
-        b = static_cast<uint8_t>(color[2] * 255.0f);
+        io::MappedFile existing(fname);
+        if (existing.IsOpen() && existing.size() == buffer.size() && std::memcmp(existing.data(), buffer.data(), buffer.size()) == 0)
+            return true;
+    }
+
+    return io::WriteFileAtomic(fname, buffer);
+}
 
-        stream << r << ' ' << g << ' ' << b << "\r\n";
+void Palette::SaveToBuffer(std::string &buffer, const Codec *codec) const
+{
+    if (!codec)
+        codec = Codecs::FindByName("jasc");
+
+    codec->Encode(*this, buffer);
+}
+
+void Palette::SnapTo15Bit()
+{
+    for (size_t chunk = 0; chunk < GetChunkCount(); ++chunk)
+        bgr555::Snap(GetChunk(chunk));
+}
+
+uint64_t Palette::Hash() const
+{
+    uint64_t hash = SizeHash(m_Size);
+    size_t idx = 0;
+
+    for (size_t chunk = 0; chunk < GetChunkCount(); ++chunk)
+    {
+        for (auto &color : GetChunk(chunk))
+            hash += SlotHash(idx++, color);
     }
+
+    return hash;
 }
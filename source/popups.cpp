@@ -1,5 +1,6 @@
 #include "popups.hpp"
 #include <imgui.h>
+#include <algorithm>
 
 void PopupManager::UpdateAndDraw()
 {
@@ -28,11 +29,14 @@ void PopupManager::UpdatePopupStates()
         return false;
     });
 
+    // Closed popups are dropped, so shortcuts go to the one on screen;
+    // those still waiting for their turn are kept.
     m_OpenedPopups.remove_if([this](const auto &popup) {
-        if (ImGui::IsPopupOpen(popup->GetName().c_str()))
+        const auto &name = popup->GetName();
+        if (ImGui::IsPopupOpen(name.c_str()))
             return false;
 
-        return false;
+        return std::find(m_PopupsToOpen.begin(), m_PopupsToOpen.end(), name) == m_PopupsToOpen.end();
     });
 }
 
@@ -3,7 +3,7 @@
 
 #define IMGUI_DEFINE_MATH_OPERATORS
 #include <imgui.h>
-#include <fstream>
+#include <cmath>
 #include <GLFW/glfw3.h>
 #include "fs.hpp"
 
@@ -16,15 +16,71 @@ namespace Popups
     {
     }
 
+    // Files are parsed on the job system; the UI thread only picks up
+    // batches that are completely done.
+    void Combine::LoadFiles(const std::vector<std::string> &files)
+    {
+        auto batch = JobBatch<LoadedFile>::Run(JobSystem::Get(), files.size(), [files](size_t i, LoadedFile &result) {
+            try
+            {
+                result.palette.LoadFromFile(files[i]);
+            }
+            catch (const char *e)
+            {
+                result.error = e;
+            }
+            catch (const std::exception &e)
+            {
+                result.error = e.what();
+            }
+        }, glfwPostEmptyEvent); // Wakes the main loop in case it is waiting for input.
+
+        m_PendingLoads.push_back({ files, batch });
+    }
+
+    void Combine::CollectLoadedFiles()
+    {
+        bool changed = false;
+
+        for (auto it = m_PendingLoads.begin(); it != m_PendingLoads.end();)
+        {
+            if (!it->batch->IsDone())
+            {
+                ++it;
+                continue;
+            }
+
+            auto &results = it->batch->GetResults();
+            for (size_t i = 0; i < results.size(); ++i)
+            {
+                const auto &fname = it->files[i];
+                if (results[i].error.empty())
+                {
+                    m_LoadedFiles[fname] = std::move(results[i].palette);
+                    continue;
+                }
+
+                m_Errors.push_back(fs::GetFilename(fname) + ": " + results[i].error);
+                std::erase(m_Files, fname);
+            }
+
+            it = m_PendingLoads.erase(it);
+            changed = true;
+        }
+
+        if (changed)
+            CombineFiles();
+    }
+
     void Combine::CombineFiles()
     {
         m_Palette.clear();
-        Palette temp;
 
         for (auto &path : m_Files)
         {
-            temp.LoadFromFile(path);
-            m_Palette += temp;
+            auto it = m_LoadedFiles.find(path);
+            if (it != m_LoadedFiles.end())
+                m_Palette += it->second;
         }
     }
 
@@ -40,6 +96,8 @@ namespace Popups
 
     void Combine::Draw()
     {
+        CollectLoadedFiles();
+
         float height = ImGui::GetContentRegionAvail().y - ImGui::GetFrameHeightWithSpacing() - ImGui::GetStyle().ItemSpacing.y;
         if (ImGui::BeginChild("##CombineWindow", ImVec2(0.0f, height)))
         {
@@ -74,11 +132,13 @@ namespace Popups
 
         ImGui::Spacing();
 
+        ImGui::BeginDisabled(!m_PendingLoads.empty());
         if (ImGui::Button("Load"))
         {
             Load();
             SetCloseFlag(true);
         }
+        ImGui::EndDisabled();
 
         ImGui::SameLine();
         
@@ -90,7 +150,7 @@ namespace Popups
     {
         if (key == GLFW_KEY_ESCAPE)
             SetCloseFlag(true);
-        else if (key == GLFW_KEY_ENTER)
+        else if (key == GLFW_KEY_ENTER && m_PendingLoads.empty())
         {
             Load();
             SetCloseFlag(true);
@@ -99,23 +159,13 @@ namespace Popups
 
     void Combine::Load()
     {
-        size_t numFiles = m_Palette.size() / 256;
-        size_t remaining = m_Palette.size() % 256;
-
-        for (size_t i = 0; i < m_Palette.size(); ++i)
+        // Each tab gets one chunk of the combined palette, shared rather
+        // than copied.
+        for (size_t begin = 0; begin < m_Palette.size(); begin += Palette::MaxJascColors)
         {
-            int paletteIdx = i % 256;
-            if (paletteIdx == 0)
-            {
-                auto &ctx = Context::CreateNewContext();
-                ctx.isDirty = true;
-                if (i / 256 != numFiles)
-                    ctx.palette.resize(256);
-                else
-                    ctx.palette.resize(remaining);
-            }
-
-            Context::GetContext().palette[paletteIdx] = m_Palette[i];
+            auto &ctx = Context::CreateNewContext();
+            ctx.SetPalette(m_Palette.Slice(begin, std::min(Palette::MaxJascColors, m_Palette.size() - begin)));
+            ctx.savedHash.reset();
         }
     }
 
@@ -123,10 +173,28 @@ namespace Popups
     {
         if (ImGui::Button("Add Palette"))
         {
-            if (fs::OpenFilePrompt([this](const char *path) { m_Files.push_back(path); }))
-                CombineFiles();
+            std::vector<std::string> newFiles;
+            if (fs::OpenFilePrompt([this, &newFiles](const char *path) {
+                m_Files.push_back(path);
+                if (!m_LoadedFiles.count(path))
+                    newFiles.push_back(path);
+            }))
+                LoadFiles(newFiles);
+        }
+
+        if (!m_PendingLoads.empty())
+        {
+            size_t remaining = 0;
+            for (const auto &load : m_PendingLoads)
+                remaining += load.batch->GetRemaining();
+
+            ImGui::SameLine();
+            ImGui::Text("Loading %zu file(s)...", remaining);
         }
 
+        for (const auto &error : m_Errors)
+            ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "%s", error.c_str());
+
         ImGui::Spacing();
 
         ImGui::BeginChild("##Filenames", ImVec2(0, 0), true);
@@ -199,7 +267,7 @@ namespace Popups
 
         ImGui::Dummy(ImVec2(ImGui::GetFrameHeight() * 0.25f, 0.0f));
         ImGui::SameLine();
-        ImGui::Text("This will load %i file(s) into the editor.", (int)std::ceilf(num_colors / 256.0f));
+        ImGui::Text("This will load %i file(s) into the editor.", (int)std::ceil(num_colors / 256.0f));
         ImGui::SameLine();
         ImGui::Dummy(ImVec2(ImGui::GetFrameHeight() * 0.25f, 0.0f));
 
@@ -212,21 +280,7 @@ namespace Popups
     }
 
     void Combine::PaletteEditor()
-    {            
-        ImGui::BeginChild("Colors", ImVec2(0.0f, 0.0f), true, ImGuiWindowFlags_AlwaysAutoResize);
-
-        for (int i = 0; i < m_Palette.size(); ++i)
-        {
-            char label[20];
-            snprintf(label, 20, "Color #%i", i);
-            auto color = m_Palette[i];
-            ImVec4 color_vec4 = ImVec4(color[0], color[1], color[2], 1.0f);
-            ImGui::ColorButton(label, color_vec4, ImGuiColorEditFlags_NoDragDrop | ImGuiColorEditFlags_NoInputs, ImVec2(30.0f, 30.0f));
-
-            if (i % 8 != 7)
-                ImGui::SameLine();
-        }
-
-        ImGui::EndChild();
+    {
+        m_SwatchView.Draw("Colors", m_Palette);
     }
-}
\ No newline at end of file
+}
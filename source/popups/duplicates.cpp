@@ -0,0 +1,91 @@
+#include "popups/duplicates.hpp"
+#include "context.hpp"
+#include "dedupe.hpp"
+#include "fs.hpp"
+
+#define IMGUI_DEFINE_MATH_OPERATORS
+#include <imgui.h>
+#include <GLFW/glfw3.h>
+
+namespace Popups
+{
+    Duplicates::Duplicates() : Popup("Duplicates", true, true, ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_NoMove)
+    {
+        Refresh();
+    }
+
+    void Duplicates::Refresh()
+    {
+        const auto &contexts = Context::GetOpenContexts();
+
+        DedupeIndex index;
+        for (size_t i = 0; i < contexts.size(); ++i)
+        {
+            if (!contexts[i]->IsLoading())
+            {
+                contexts[i]->Expand();
+                index.Update(std::to_string(i), contexts[i]->palette);
+            }
+        }
+
+        m_Groups.clear();
+        for (const auto &group : index.GetDuplicateGroups())
+        {
+            auto &names = m_Groups.emplace_back();
+            for (const auto &key : group)
+            {
+                const auto &ctx = contexts[std::stoul(key)];
+                names.push_back(ctx->loadedFile.empty() ? "Untitled" : fs::GetFilename(ctx->loadedFile));
+            }
+        }
+
+        Context::EnforceMemoryBudget();
+    }
+
+    void Duplicates::PreDraw()
+    {
+        auto pos = ImGui::GetMainViewport()->Pos;
+        auto size = ImGui::GetWindowSize();
+
+        auto center = ImVec2(pos.x + size.x * 0.5f, pos.y + size.y * 0.5f);
+
+        ImGui::SetNextWindowPos(center, ImGuiCond_Appearing, ImVec2(0.5f, 0.5f));
+        ImGui::SetNextWindowSize(size * 0.5f, ImGuiCond_Appearing);
+    }
+
+    void Duplicates::Draw()
+    {
+        float height = ImGui::GetContentRegionAvail().y - ImGui::GetFrameHeightWithSpacing() - ImGui::GetStyle().ItemSpacing.y;
+        ImGui::BeginChild("###groups", ImVec2(0.0f, height), true);
+
+        if (m_Groups.empty())
+            ImGui::Text("No open palettes share the same colors.");
+
+        for (size_t i = 0; i < m_Groups.size(); ++i)
+        {
+            if (i > 0)
+                ImGui::Separator();
+
+            for (const auto &name : m_Groups[i])
+                ImGui::BulletText("%s", name.c_str());
+        }
+
+        ImGui::EndChild();
+
+        ImGui::Spacing();
+
+        if (ImGui::Button("Refresh"))
+            Refresh();
+
+        ImGui::SameLine();
+
+        if (ImGui::Button("Close"))
+            SetCloseFlag(true);
+    }
+
+    void Duplicates::ProcessShortcuts(int key, int)
+    {
+        if (key == GLFW_KEY_ESCAPE)
+            SetCloseFlag(true);
+    }
+}
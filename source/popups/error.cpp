@@ -21,6 +21,5 @@ namespace Popups
             if (m_OkCallback) m_OkCallback();
             ImGui::CloseCurrentPopup();
         }
-        ImGui::EndPopup();
     }
 }
@@ -1,5 +1,8 @@
 #include "popups/logger.hpp"
 #include "context.hpp"
+#include "fs.hpp"
+#include "io.hpp"
+#include <cstdio>
 
 #define IMGUI_DEFINE_MATH_OPERATORS
 #include <imgui.h>
@@ -19,22 +22,143 @@ namespace Popups
         ImGui::SetNextWindowSize(size * 0.75f, ImGuiCond_Appearing);
     }
 
+    static void ColorSwatch(const char *id, const Color &color)
+    {
+        auto f = color.ToFloat();
+        // As tall as a line of text, so every row has the same height.
+        float size = ImGui::GetTextLineHeight();
+        ImGui::ColorButton(id, ImVec4(f[0], f[1], f[2], 1.0f), 0, ImVec2(size, size));
+    }
+
+    static void PrintDetails(const Actions::ModifyColor &action, const Palette &)
+    {
+        ImGui::Text("%u", action.index);
+        ImGui::SameLine();
+        ColorSwatch("##old", action.oldColor);
+        ImGui::SameLine();
+        ImGui::Text("->");
+        ImGui::SameLine();
+        ColorSwatch("##new", action.newColor);
+    }
+
+    static void PrintDetails(const Actions::SwapColors &action, const Palette &palette)
+    {
+        // The palette may have shrunk since, then there are no colors to show.
+        if (action.first >= palette.size() || action.second >= palette.size())
+        {
+            ImGui::Text("%u <-> %u", action.first, action.second);
+            return;
+        }
+
+        ImGui::Text("%u", action.second);
+        ImGui::SameLine();
+        ColorSwatch("##first", palette[action.first]);
+        ImGui::SameLine();
+        ImGui::Text("->");
+        ImGui::SameLine();
+        ImGui::Text("%u", action.first);
+        ImGui::SameLine();
+        ColorSwatch("##second", palette[action.second]);
+    }
+
+    static void PrintDetails(const Actions::ChangeColorCount &action, const Palette &)
+    {
+        ImGui::Text("%u -> %u", action.oldSize, action.newSize);
+    }
+
+    static void PrintDetails(const Actions::TransformColors &action, const Palette &)
+    {
+        ImGui::Text("%s, %u - %u", action.transform.GetName(), action.begin, action.begin + action.count - 1);
+    }
+
+    static int FormatDetails(char *out, size_t size, const Actions::ModifyColor &action)
+    {
+        return std::snprintf(out, size, "%u #%02X%02X%02X -> #%02X%02X%02X", action.index,
+            action.oldColor.r, action.oldColor.g, action.oldColor.b, action.newColor.r, action.newColor.g, action.newColor.b);
+    }
+
+    static int FormatDetails(char *out, size_t size, const Actions::SwapColors &action)
+    {
+        return std::snprintf(out, size, "%u <-> %u", action.first, action.second);
+    }
+
+    static int FormatDetails(char *out, size_t size, const Actions::ChangeColorCount &action)
+    {
+        return std::snprintf(out, size, "%u -> %u", action.oldSize, action.newSize);
+    }
+
+    static int FormatDetails(char *out, size_t size, const Actions::TransformColors &action)
+    {
+        return std::snprintf(out, size, "%s %d %d %d, %u - %u", action.transform.GetName(), action.transform.a, action.transform.b, action.transform.c,
+            action.begin, action.begin + action.count - 1);
+    }
+
+    // One line per record, oldest first, with joined records marked by a
+    // plus. The buffer is built once for the whole file.
+    void Logger::Export(const char *path)
+    {
+        const auto &ctx = Context::GetContext();
+        const auto &actions = ctx.actionRegister;
+
+        std::string buffer;
+        buffer.reserve(64 * (actions.GetRecordCount() + 2));
+
+        char line[160];
+        std::snprintf(line, sizeof(line), "# %s: %zu undo step(s), %zu redo step(s), %zu record(s)\n",
+            ctx.loadedFile.empty() ? "Untitled" : ctx.loadedFile.c_str(), actions.GetUndoCount(), actions.GetRedoCount(), actions.GetRecordCount());
+        buffer += line;
+
+        for (size_t i = 0; i < actions.GetRecordCount(); ++i)
+        {
+            int n = std::visit([&](const auto &action) {
+                int len = std::snprintf(line, sizeof(line), "%s %8zu %c %-16s ", i < actions.GetRecordCursor() ? "undo" : "redo", i,
+                    actions.IsJoined(i) ? '+' : ' ', action.Name);
+                return len + FormatDetails(line + len, sizeof(line) - len, action);
+            }, actions.GetRecord(i));
+
+            buffer.append(line, std::min<size_t>(n, sizeof(line) - 1));
+            buffer += '\n';
+        }
+
+        m_Message = io::WriteFileAtomic(path, buffer) ? "Log written to " + fs::GetFilename(path) + "." : "Could not write the log file.";
+    }
+
     void Logger::Draw()
     {
-        auto printActions = [this](const auto &list) {
+        const auto &ctx = Context::GetContext();
+        const auto &actions = ctx.actionRegister;
+
+        // Undo records are listed newest first, redo records in the order
+        // they would be redone. Records joined to a step are indented. Only
+        // the rows in view are drawn.
+        auto printActions = [&](size_t first, size_t last, bool reverse) {
             ImGui::BeginChild("###list", ImVec2(0.0f, ImGui::GetMainViewport()->Size.y * 0.65f), true, ImGuiWindowFlags_NoDecoration);
+
+            ImGuiListClipper clipper;
+            clipper.Begin(static_cast<int>(last - first));
+            while (clipper.Step())
             {
-                for (auto it = list.rbegin(); it != list.rend(); ++it)
+                for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; ++row)
                 {
-                    auto action = *it;
-                    ImGui::Text("%s", action->ToString().c_str());
-                    ImGui::SameLine();
+                    size_t i = reverse ? last - 1 - row : first + row;
+                    ImGui::PushID(static_cast<int>(i));
+                    if (actions.IsJoined(i))
+                        ImGui::Indent();
+                    std::visit([&](const auto &action) {
+                        ImGui::TextUnformatted(action.Name);
+                        ImGui::SameLine();
 
-                    ImGui::BeginGroup();
-                    action->PrintDetails();
-                    ImGui::EndGroup();
+                        ImGui::BeginGroup();
+                        PrintDetails(action, ctx.palette);
+                        ImGui::EndGroup();
+                    }, actions.GetRecord(i));
+                    if (actions.IsJoined(i))
+                        ImGui::Unindent();
+                    ImGui::PopID();
                 }
             }
+            clipper.End();
+
             ImGui::EndChild();
         };
 
@@ -42,14 +166,25 @@ namespace Popups
 
         if (ImGui::BeginTabItem("Undo"))
         {
-            printActions(Context::GetContext().actionRegister.GetUndoStack());
+            printActions(0, actions.GetRecordCursor(), true);
             ImGui::EndTabItem();
         }
         if (ImGui::BeginTabItem("Redo"))
         {
-            printActions(Context::GetContext().actionRegister.GetRedoStack());
+            printActions(actions.GetRecordCursor(), actions.GetRecordCount(), false);
             ImGui::EndTabItem();
         }
         ImGui::EndTabBar();
+
+        ImGui::Text("%zu step(s), %.1f KB of history", actions.GetUndoCount() + actions.GetRedoCount(), actions.GetMemoryUsage() / 1024.0);
+
+        if (ImGui::Button("Export Log..."))
+            fs::SaveFilePrompt([this](const char *path) { Export(path); }, fs::FileType::Text);
+
+        if (!m_Message.empty())
+        {
+            ImGui::SameLine();
+            ImGui::TextUnformatted(m_Message.c_str());
+        }
     }
-}
\ No newline at end of file
+}
\ No newline at end of file
@@ -0,0 +1,165 @@
+#include "popups/macros.hpp"
+#include "context.hpp"
+#include "fs.hpp"
+
+#define IMGUI_DEFINE_MATH_OPERATORS
+#include <imgui.h>
+#include <GLFW/glfw3.h>
+
+namespace Popups
+{
+    Macros::Macros(std::shared_ptr<Macro> macro) : 
+        Popup("Macros", true, true, ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_NoMove),
+        m_Macro(macro)
+    {
+    }
+
+    // Every tab has its own palette and history, so they are all edited at
+    // once. The tab that is recording is left out.
+    void Macros::ApplyToTabs()
+    {
+        std::vector<Context *> targets;
+        for (auto &ctx : Context::GetOpenContexts())
+        {
+            if (!ctx->IsLoading() && ctx->recordingMacro != m_Macro)
+            {
+                ctx->Expand();
+                targets.push_back(ctx.get());
+            }
+        }
+
+        std::vector<size_t> skipped(targets.size());
+        JobSystem::Get().ParallelFor(targets.size(), [this, &targets, &skipped](size_t i) {
+            skipped[i] = m_Macro->ApplyTo(targets[i]->palette, targets[i]->actionRegister);
+        });
+
+        size_t totalSkipped = 0;
+        for (size_t i = 0; i < targets.size(); ++i)
+            totalSkipped += skipped[i];
+
+        // Every tab was expanded for this, compact them again if needed.
+        Context::EnforceMemoryBudget();
+
+        m_Messages.clear();
+        m_Messages.push_back("Applied to " + std::to_string(targets.size()) + " tab(s), " + std::to_string(totalSkipped) + " action(s) skipped.");
+    }
+
+    // Files are rewritten on the job system with a copy of the macro, so
+    // recording can go on meanwhile.
+    void Macros::ApplyToFiles(const std::vector<std::string> &files)
+    {
+        auto macro = std::make_shared<const Macro>(*m_Macro);
+
+        m_Files = files;
+        m_Messages.clear();
+        m_Pending = JobBatch<std::string>::Run(JobSystem::Get(), files.size(), [files, macro](size_t i, std::string &error) {
+            error = macro->ApplyToFile(files[i]);
+        }, glfwPostEmptyEvent);
+    }
+
+    void Macros::CollectAppliedFiles()
+    {
+        if (!m_Pending || !m_Pending->IsDone())
+            return;
+
+        size_t failed = 0;
+        auto &errors = m_Pending->GetResults();
+        for (size_t i = 0; i < errors.size(); ++i)
+        {
+            if (errors[i].empty())
+                continue;
+
+            m_Messages.push_back(fs::GetFilename(m_Files[i]) + ": " + errors[i]);
+            ++failed;
+        }
+
+        m_Messages.insert(m_Messages.begin(), "Applied to " + std::to_string(errors.size() - failed) + " file(s).");
+        m_Pending.reset();
+    }
+
+    void Macros::PreDraw()
+    {
+        auto pos = ImGui::GetMainViewport()->Pos;
+        auto size = ImGui::GetWindowSize();
+
+        auto center = ImVec2(pos.x + size.x * 0.5f, pos.y + size.y * 0.5f);
+
+        ImGui::SetNextWindowPos(center, ImGuiCond_Appearing, ImVec2(0.5f, 0.5f));
+        ImGui::SetNextWindowSize(size * 0.5f, ImGuiCond_Appearing);
+    }
+
+    void Macros::Draw()
+    {
+        CollectAppliedFiles();
+
+        bool isBusy = m_Pending != nullptr;
+
+        ImGui::Text("Recorded actions: %zu", m_Macro->size());
+        ImGui::Spacing();
+
+        ImGui::BeginDisabled(isBusy || m_Macro->empty());
+
+        if (ImGui::Button("Apply to Open Tabs"))
+            ApplyToTabs();
+
+        ImGui::SameLine();
+
+        if (ImGui::Button("Apply to Files..."))
+        {
+            std::vector<std::string> files;
+            if (fs::OpenFilePrompt([&files](const char *path) { files.push_back(path); }) && !files.empty())
+                ApplyToFiles(files);
+        }
+
+        ImGui::EndDisabled();
+
+        if (isBusy)
+        {
+            ImGui::SameLine();
+            ImGui::Text("Applying to %zu file(s)...", m_Pending->GetRemaining());
+        }
+
+        float height = ImGui::GetContentRegionAvail().y - ImGui::GetFrameHeightWithSpacing() - ImGui::GetStyle().ItemSpacing.y;
+        ImGui::BeginChild("###messages", ImVec2(0.0f, height), true);
+
+        for (const auto &message : m_Messages)
+            ImGui::TextWrapped("%s", message.c_str());
+
+        ImGui::EndChild();
+
+        ImGui::Spacing();
+
+        ImGui::BeginDisabled(isBusy);
+
+        if (ImGui::Button("Save Macro") && !m_Macro->empty())
+        {
+            fs::SaveFilePrompt([this](const char *path) {
+                if (!m_Macro->Save(path))
+                    m_Messages.push_back("Could not save the macro.");
+            }, fs::FileType::Macro);
+        }
+
+        ImGui::SameLine();
+
+        if (ImGui::Button("Load Macro"))
+        {
+            fs::OpenFilePrompt([this](const char *path) {
+                if (!m_Macro->Load(path))
+                    m_Messages.push_back(fs::GetFilename(path) + ": not a valid macro file.");
+            }, nullptr, fs::FileType::Macro);
+        }
+
+        ImGui::EndDisabled();
+
+        ImGui::SameLine();
+
+        if (ImGui::Button("Close") && !isBusy)
+            SetCloseFlag(true);
+    }
+
+    void Macros::ProcessShortcuts(int key, int)
+    {
+        if (key == GLFW_KEY_ESCAPE && !m_Pending)
+            SetCloseFlag(true);
+    }
+}
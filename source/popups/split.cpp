@@ -5,6 +5,8 @@
 #include <GLFW/glfw3.h>
 
 #include "context.hpp"
+#include <cmath>
+#include <vector>
 
 namespace Popups
 {
@@ -23,25 +25,18 @@ namespace Popups
 
     void Split::Load()
     {
-        auto &palette = Context::GetContext().palette;
+        const auto &palette = Context::GetContext().palette;
 
-        size_t numFiles = palette.size() / m_NumColors;
-        size_t remaining = palette.size() % m_NumColors;
-
-        for (size_t i = 0; i < palette.size(); ++i)
+        // With a multiple of the chunk size per file, the new tabs share
+        // the chunks instead of copying them.
+        for (size_t begin = 0; begin < palette.size(); begin += m_NumColors)
         {
-            int paletteIdx = i % m_NumColors;
-            if (paletteIdx == 0)
-            {
-                auto &ctx = Context::CreateNewContext();
-                ctx.isDirty = true;
-                if (i / m_NumColors != numFiles)
-                    ctx.palette.resize(m_NumColors);
-                else
-                    ctx.palette.resize(remaining);
-            }
-
-            Context::GetContext().palette[paletteIdx] = palette[i];
+            size_t count = std::min(m_NumColors, palette.size() - begin);
+            auto slice = palette.Slice(begin, count);
+
+            auto &ctx = Context::CreateNewContext();
+            ctx.SetPalette(slice);
+            ctx.savedHash.reset();
         }
     }
 
@@ -52,7 +47,7 @@ namespace Popups
     
         int oldNumColors = m_NumColors;
         if (ImGui::InputInt("Colors Per File", &oldNumColors, 1, 5))
-            m_NumColors = (size_t)std::min(std::max(1ULL, (size_t)oldNumColors), Context::GetContext().palette.size());
+            m_NumColors = (size_t)std::min(std::max<size_t>(1, oldNumColors), Context::GetContext().palette.size());
 
         ImGui::Spacing();
 
@@ -63,7 +58,7 @@ namespace Popups
 
         ImGui::Dummy(ImVec2(ImGui::GetFrameHeight() * 0.25f, 0.0f));
         ImGui::SameLine();
-        ImGui::Text("This will load %i file(s) into the editor.", (int)std::ceilf(numColors / (m_NumColors * 1.0f)));
+        ImGui::Text("This will load %i file(s) into the editor.", (int)std::ceil(numColors / (m_NumColors * 1.0f)));
         ImGui::SameLine();
         ImGui::Dummy(ImVec2(ImGui::GetFrameHeight() * 0.25f, 0.0f));
 
@@ -96,4 +91,4 @@ namespace Popups
             SetCloseFlag(true);
         }
     }
-}
\ No newline at end of file
+}
\ No newline at end of file
@@ -0,0 +1,164 @@
+#include "popups/transform_colors.hpp"
+#include "context.hpp"
+
+#define IMGUI_DEFINE_MATH_OPERATORS
+#include <imgui.h>
+#include <GLFW/glfw3.h>
+
+namespace Popups
+{
+    TransformColors::TransformColors() :
+        Popup("Transform Colors", true, false, ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_NoMove),
+        m_Context(Context::GetContext())
+    {
+        m_Last = static_cast<int>(m_Context.palette.size()) - 1;
+    }
+
+    Transform TransformColors::GetTransform() const
+    {
+        switch (static_cast<Transform::Type>(m_Type))
+        {
+        case Transform::Type::Gamma: return Transform::Gamma(m_Gamma);
+        case Transform::Type::BrightnessContrast: return Transform::BrightnessContrast(m_Brightness, m_Contrast);
+        case Transform::Type::Invert: return Transform::Invert();
+        case Transform::Type::Grayscale: return Transform::Grayscale();
+        case Transform::Type::Snap15Bit: return Transform::Snap15Bit();
+        default: return Transform::HueSaturationValue(m_Hue, m_Saturation, m_Value);
+        }
+    }
+
+    // Only runs the transform when the settings changed since the last
+    // frame, and then on the job system, so dragging a slider stays smooth
+    // on large palettes.
+    void TransformColors::UpdatePreview()
+    {
+        size_t begin = m_First;
+        size_t count = m_Last - m_First + 1;
+        auto transform = GetTransform();
+
+        bool rangeChanged = begin != m_PreviewBegin || count != m_Original.size();
+        if (!rangeChanged && transform == m_Previewed)
+            return;
+
+        auto &palette = m_Context.palette;
+        if (rangeChanged)
+        {
+            RestoreOriginal();
+            m_PreviewBegin = begin;
+            m_Original.resize(count);
+            palette.CopyTo(begin, count, m_Original.data());
+        }
+        else
+        {
+            palette.CopyFrom(begin, count, m_Original.data());
+        }
+
+        if (!transform.IsIdentity())
+            transform.Apply(palette, begin, count);
+        m_Previewed = transform;
+    }
+
+    void TransformColors::RestoreOriginal()
+    {
+        m_Context.palette.CopyFrom(m_PreviewBegin, m_Original.size(), m_Original.data());
+    }
+
+    void TransformColors::Apply()
+    {
+        RestoreOriginal();
+
+        auto transform = GetTransform();
+        if (!m_Original.empty() && !transform.IsIdentity())
+            m_Context.actionRegister.RegisterAction<Actions::TransformColors>(m_PreviewBegin, m_Original.size(), transform);
+
+        m_Original.clear();
+        SetCloseFlag(true);
+    }
+
+    void TransformColors::PreDraw()
+    {
+        auto pos = ImGui::GetMainViewport()->Pos;
+        auto size = ImGui::GetWindowSize();
+
+        auto center = ImVec2(pos.x + size.x * 0.5f, pos.y + size.y * 0.5f);
+
+        ImGui::SetNextWindowPos(center, ImGuiCond_Appearing, ImVec2(0.5f, 0.5f));
+        ImGui::SetNextWindowSize(ImVec2(size.x * 0.4f, 0.0f), ImGuiCond_Appearing);
+    }
+
+    void TransformColors::Draw()
+    {
+        int maxIndex = static_cast<int>(m_Context.palette.size()) - 1;
+        if (maxIndex < 0)
+        {
+            ImGui::Text("The palette has no colors.");
+            if (ImGui::Button("Close"))
+                SetCloseFlag(true);
+            return;
+        }
+
+        if (ImGui::BeginCombo("Transform", Transform::GetTypeName(static_cast<Transform::Type>(m_Type))))
+        {
+            for (int i = 0; i < static_cast<int>(Transform::Type::Count); ++i)
+            {
+                if (ImGui::Selectable(Transform::GetTypeName(static_cast<Transform::Type>(i)), m_Type == i))
+                    m_Type = i;
+            }
+            ImGui::EndCombo();
+        }
+
+        if (ImGui::InputInt("First Index", &m_First))
+            m_First = std::clamp(m_First, 0, m_Last);
+        if (ImGui::InputInt("Last Index", &m_Last))
+            m_Last = std::clamp(m_Last, m_First, maxIndex);
+
+        ImGui::Spacing();
+
+        switch (static_cast<Transform::Type>(m_Type))
+        {
+        case Transform::Type::HueSaturationValue:
+            ImGui::SliderInt("Hue", &m_Hue, -180, 180, "%d deg");
+            ImGui::SliderInt("Saturation", &m_Saturation, -100, 100, "%d%%");
+            ImGui::SliderInt("Value", &m_Value, -100, 100, "%d%%");
+            break;
+        case Transform::Type::Gamma:
+            ImGui::SliderFloat("Gamma", &m_Gamma, 0.1f, 10.0f, "%.2f", ImGuiSliderFlags_Logarithmic);
+            break;
+        case Transform::Type::BrightnessContrast:
+            ImGui::SliderInt("Brightness", &m_Brightness, -100, 100, "%d%%");
+            ImGui::SliderInt("Contrast", &m_Contrast, -100, 100, "%d%%");
+            break;
+        default:
+            ImGui::Text("No settings.");
+            break;
+        }
+
+        UpdatePreview();
+
+        ImGui::Spacing();
+
+        if (ImGui::Button("Apply"))
+            Apply();
+
+        ImGui::SameLine();
+
+        if (ImGui::Button("Cancel"))
+        {
+            RestoreOriginal();
+            SetCloseFlag(true);
+        }
+    }
+
+    void TransformColors::ProcessShortcuts(int key, int)
+    {
+        if (key == GLFW_KEY_ESCAPE)
+        {
+            RestoreOriginal();
+            SetCloseFlag(true);
+        }
+        else if (key == GLFW_KEY_ENTER)
+        {
+            Apply();
+        }
+    }
+}
@@ -0,0 +1,67 @@
+#include "swatch_grid.hpp"
+#include <cstring>
+
+SwatchGrid::SwatchGrid(size_t columns, int cellSize, int gap) : m_Columns(std::max<size_t>(1, columns)), m_CellSize(MinCellSize), m_Gap(std::max(0, gap))
+{
+    SetCellSize(cellSize);
+}
+
+void SwatchGrid::SetCellSize(int cellSize)
+{
+    m_CellSize = std::clamp(cellSize, MinCellSize, MaxCellSize);
+}
+
+SwatchGrid::Rect SwatchGrid::GetSwatchRect(size_t idx) const
+{
+    int x = static_cast<int>(idx % m_Columns) * m_CellSize;
+    int y = static_cast<int>(idx / m_Columns) * m_CellSize;
+    // Small cells drop the gap rather than vanish.
+    int size = m_CellSize - (m_CellSize > 2 * m_Gap ? m_Gap : 0);
+    return { x, y, x + size, y + size };
+}
+
+size_t SwatchGrid::HitTest(int x, int y, size_t numColors) const
+{
+    if (x < 0 || y < 0 || x >= GetWidth())
+        return SIZE_MAX;
+
+    size_t idx = static_cast<size_t>(y / m_CellSize) * m_Columns + static_cast<size_t>(x / m_CellSize);
+    return idx < numColors ? idx : SIZE_MAX;
+}
+
+void SwatchGrid::Rasterize(const Palette &palette, size_t firstRow, size_t numRows, std::vector<uint8_t> &rgba) const
+{
+    size_t width = GetWidth();
+    size_t stride = width * 4;
+    rgba.assign(stride * numRows * m_CellSize, 0);
+
+    std::vector<uint8_t> line(stride);
+    for (size_t row = 0; row < numRows; ++row)
+    {
+        size_t first = (firstRow + row) * m_Columns;
+        if (first >= palette.size())
+            break;
+
+        // Every pixel line of a row is the same, so one is built and
+        // copied down.
+        std::fill(line.begin(), line.end(), 0);
+        for (size_t column = 0; column < m_Columns && first + column < palette.size(); ++column)
+        {
+            auto rect = GetSwatchRect(first + column);
+            const auto &color = palette[first + column];
+            for (int x = rect.x0; x < rect.x1; ++x)
+            {
+                uint8_t *pixel = &line[x * 4];
+                pixel[0] = color.r;
+                pixel[1] = color.g;
+                pixel[2] = color.b;
+                pixel[3] = 255;
+            }
+        }
+
+        auto rect = GetSwatchRect(first);
+        uint8_t *out = rgba.data() + row * m_CellSize * stride;
+        for (int y = 0; y < rect.y1 - rect.y0; ++y)
+            std::memcpy(out + y * stride, line.data(), stride);
+    }
+}
@@ -0,0 +1,110 @@
+#include "swatch_view.hpp"
+
+#define IMGUI_DEFINE_MATH_OPERATORS
+#include <imgui.h>
+#include <algorithm>
+#include <cmath>
+
+bool SwatchView::Draw(const char *id, const Palette &palette)
+{
+    auto &io = ImGui::GetIO();
+    bool swapped = false;
+
+    // Ctrl + wheel zooms instead of scrolling.
+    ImGui::BeginChild(id, ImVec2(0.0f, 0.0f), true, io.KeyCtrl ? ImGuiWindowFlags_NoScrollWithMouse : 0);
+    if (io.KeyCtrl && io.MouseWheel != 0.0f && ImGui::IsWindowHovered())
+        m_Grid.SetCellSize(m_Grid.GetCellSize() + (io.MouseWheel > 0.0f ? 2 : -2));
+
+    m_Grid.FitColumns(static_cast<int>(ImGui::GetContentRegionAvail().x));
+    int cellSize = m_Grid.GetCellSize();
+    size_t numColors = palette.size();
+
+    // Dragging near the top or bottom edge scrolls, so a swatch can be
+    // dropped anywhere in the palette.
+    if (m_DragFrom != SIZE_MAX && ImGui::IsMouseDragging(ImGuiMouseButton_Left))
+    {
+        float y = io.MousePos.y - ImGui::GetWindowPos().y;
+        float step = cellSize * 20.0f * io.DeltaTime;
+        if (y < cellSize)
+            ImGui::SetScrollY(ImGui::GetScrollY() - step);
+        else if (y > ImGui::GetWindowHeight() - cellSize)
+            ImGui::SetScrollY(ImGui::GetScrollY() + step);
+    }
+
+    ImVec2 origin = ImGui::GetCursorScreenPos();
+    ImDrawList *drawList = ImGui::GetWindowDrawList();
+
+    auto toScreen = [&origin](const SwatchGrid::Rect &rect) {
+        return std::make_pair(origin + ImVec2((float)rect.x0, (float)rect.y0), origin + ImVec2((float)rect.x1, (float)rect.y1));
+    };
+
+    // Rows are spaced exactly one cell apart, so the clipper and the grid
+    // agree on where each row is.
+    ImGui::PushStyleVar(ImGuiStyleVar_ItemSpacing, ImVec2(0.0f, 0.0f));
+    ImGuiListClipper clipper;
+    clipper.Begin(static_cast<int>(m_Grid.GetRowCount(numColors)), static_cast<float>(cellSize));
+    while (clipper.Step())
+    {
+        for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; ++row)
+        {
+            size_t first = row * m_Grid.GetColumns();
+            size_t last = std::min(first + m_Grid.GetColumns(), numColors);
+            for (size_t i = first; i < last; ++i)
+            {
+                auto [min, max] = toScreen(m_Grid.GetSwatchRect(i));
+                const auto &color = palette[i];
+                drawList->AddRectFilled(min, max, IM_COL32(color.r, color.g, color.b, 255));
+            }
+            ImGui::Dummy(ImVec2(static_cast<float>(m_Grid.GetWidth()), static_cast<float>(cellSize)));
+        }
+    }
+    ImGui::PopStyleVar();
+
+    size_t hovered = SIZE_MAX;
+    if (ImGui::IsWindowHovered(ImGuiHoveredFlags_AllowWhenBlockedByActiveItem))
+    {
+        ImVec2 mouse = io.MousePos - origin;
+        hovered = m_Grid.HitTest((int)std::floor(mouse.x), (int)std::floor(mouse.y), numColors);
+    }
+
+    if (hovered != SIZE_MAX && ImGui::IsMouseClicked(ImGuiMouseButton_Left))
+    {
+        m_Selected = hovered;
+        m_DragFrom = m_AllowSwap ? hovered : SIZE_MAX;
+    }
+
+    bool isDragging = m_DragFrom != SIZE_MAX && ImGui::IsMouseDragging(ImGuiMouseButton_Left);
+    if (m_DragFrom != SIZE_MAX && !ImGui::IsMouseDown(ImGuiMouseButton_Left))
+    {
+        if (hovered != SIZE_MAX && hovered != m_DragFrom && m_DragFrom < numColors)
+        {
+            m_SwapFrom = m_DragFrom;
+            m_SwapTo = hovered;
+            m_Selected = hovered;
+            swapped = true;
+        }
+        m_DragFrom = SIZE_MAX;
+    }
+
+    float thickness = cellSize >= 8 ? 2.0f : 1.0f;
+    if (m_Selected < numColors)
+    {
+        auto [min, max] = toScreen(m_Grid.GetSwatchRect(m_Selected));
+        drawList->AddRect(min, max, IM_COL32_WHITE, 0.0f, 0, thickness);
+    }
+
+    if (isDragging && hovered != SIZE_MAX)
+    {
+        auto [min, max] = toScreen(m_Grid.GetSwatchRect(hovered));
+        drawList->AddRect(min, max, IM_COL32(255, 255, 0, 255), 0.0f, 0, thickness);
+        ImGui::SetTooltip("Swap #%zu with #%zu", m_DragFrom, hovered);
+    }
+    else if (hovered != SIZE_MAX)
+    {
+        const auto &color = palette[hovered];
+        ImGui::SetTooltip("Color #%zu\n%d, %d, %d", hovered, color.r, color.g, color.b);
+    }
+
+    ImGui::EndChild();
+    return swapped;
+}
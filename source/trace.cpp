@@ -0,0 +1,173 @@
+#include "trace.hpp"
+#include "io.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+std::atomic<bool> Trace::s_Enabled = false;
+
+namespace
+{
+    // The fields are atomics only so that Export may read a zone while
+    // its thread overwrites it; relaxed stores cost the same as plain ones.
+    struct Zone
+    {
+        std::atomic<const char *> name;
+        std::atomic<uint64_t> start, end;
+    };
+
+    // Written by its own thread only. count is published after the zone,
+    // so a reader that sees it also sees the zones before it.
+    struct ThreadBuffer
+    {
+        std::unique_ptr<Zone[]> zones = std::make_unique<Zone[]>(Trace::BufferSize);
+        std::atomic<uint64_t> count = 0;
+        std::atomic<uint64_t> begin = 0;
+        std::string name;
+        size_t id = 0;
+    };
+
+    const auto s_Epoch = std::chrono::steady_clock::now();
+
+    // Buffers stay registered after their thread exits, so short-lived
+    // threads still show up in the trace.
+    std::mutex s_BuffersMutex;
+    std::vector<std::shared_ptr<ThreadBuffer>> s_Buffers;
+
+    thread_local ThreadBuffer *t_Buffer = nullptr;
+
+    ThreadBuffer &GetThreadBuffer()
+    {
+        if (!t_Buffer)
+        {
+            auto buffer = std::make_shared<ThreadBuffer>();
+            std::lock_guard lock(s_BuffersMutex);
+            buffer->id = s_Buffers.size() + 1;
+            s_Buffers.push_back(buffer);
+            t_Buffer = buffer.get();
+        }
+        return *t_Buffer;
+    }
+
+    void AppendEscaped(std::string &out, const char *str)
+    {
+        for (; *str; ++str)
+        {
+            if (*str == '"' || *str == '\\')
+                out += '\\';
+            out += *str;
+        }
+    }
+}
+
+void Trace::SetEnabled(bool enabled)
+{
+    s_Enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void Trace::SetThreadName(const char *name)
+{
+    auto &buffer = GetThreadBuffer();
+    std::lock_guard lock(s_BuffersMutex);
+    buffer.name = name;
+}
+
+uint64_t Trace::Now()
+{
+    // Never 0, TraceScope uses that for "not recording".
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - s_Epoch).count();
+    return std::max<uint64_t>(1, elapsed);
+}
+
+void Trace::Record(const char *name, uint64_t start, uint64_t end)
+{
+    auto &buffer = GetThreadBuffer();
+    uint64_t count = buffer.count.load(std::memory_order_relaxed);
+
+    auto &zone = buffer.zones[count % BufferSize];
+    zone.name.store(name, std::memory_order_relaxed);
+    zone.start.store(start, std::memory_order_relaxed);
+    zone.end.store(end, std::memory_order_relaxed);
+
+    buffer.count.store(count + 1, std::memory_order_release);
+}
+
+void Trace::Export(std::string &out)
+{
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+    {
+        std::lock_guard lock(s_BuffersMutex);
+        buffers = s_Buffers;
+    }
+
+    struct Copy
+    {
+        const char *name;
+        uint64_t start, end;
+    };
+    std::vector<Copy> zones;
+    char line[256];
+
+    out = "{\"traceEvents\":[\n";
+    bool first = true;
+    for (const auto &buffer : buffers)
+    {
+        {
+            std::lock_guard lock(s_BuffersMutex);
+            if (!buffer->name.empty())
+            {
+                out += first ? "" : ",\n";
+                out += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" + std::to_string(buffer->id) + ",\"args\":{\"name\":\"";
+                AppendEscaped(out, buffer->name.c_str());
+                out += "\"}}";
+                first = false;
+            }
+        }
+
+        uint64_t count = buffer->count.load(std::memory_order_acquire);
+        uint64_t begin = std::max(buffer->begin.load(std::memory_order_relaxed), count > BufferSize ? count - BufferSize : 0);
+
+        zones.clear();
+        for (uint64_t i = begin; i < count; ++i)
+        {
+            const auto &zone = buffer->zones[i % BufferSize];
+            zones.push_back({ zone.name.load(std::memory_order_relaxed), zone.start.load(std::memory_order_relaxed), zone.end.load(std::memory_order_relaxed) });
+        }
+
+        // Zones the thread wrapped around to while they were copied may be
+        // torn, those are dropped.
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t after = buffer->count.load(std::memory_order_relaxed);
+        size_t skip = after > BufferSize + begin ? std::min<uint64_t>(zones.size(), after - BufferSize - begin) : 0;
+
+        for (size_t i = skip; i < zones.size(); ++i)
+        {
+            const auto &zone = zones[i];
+            out += first ? "" : ",\n";
+            out += "{\"name\":\"";
+            AppendEscaped(out, zone.name);
+            std::snprintf(line, sizeof(line), "\",\"ph\":\"X\",\"pid\":1,\"tid\":%zu,\"ts\":%.3f,\"dur\":%.3f}",
+                buffer->id, zone.start / 1e3, (zone.end - zone.start) / 1e3);
+            out += line;
+            first = false;
+        }
+    }
+    out += "\n]}\n";
+}
+
+bool Trace::Save(const std::string &fname)
+{
+    std::string out;
+    Export(out);
+    return io::WriteFileAtomic(fname, out);
+}
+
+void Trace::Clear()
+{
+    std::lock_guard lock(s_BuffersMutex);
+    for (auto &buffer : s_Buffers)
+        buffer->begin.store(buffer->count.load(std::memory_order_acquire), std::memory_order_relaxed);
+}
@@ -0,0 +1,339 @@
+#include "transform.hpp"
+#include "jobs.hpp"
+#include "bgr555.hpp"
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TRANSFORM_SSE2
+#endif
+
+// As in bgr555.cpp, the vector paths treat a Color as the little-endian
+// word 0x00BBGGRR. The scalar tails use the same float operations, so a
+// color comes out the same whichever path it takes.
+
+namespace
+{
+    constexpr size_t ChunksPerJob = 64;
+
+    // Shifts hue, saturation and value of colors in the range 0-255. The
+    // hue is kept in sixths of a turn, which makes the way back to RGB a
+    // branch-free formula.
+    struct HsvParams
+    {
+        float hue, saturation, value;
+    };
+
+    HsvParams GetHsvParams(const Transform &transform)
+    {
+        return { transform.a * 6.0f / 256.0f, transform.b / 100.0f, transform.c / 100.0f };
+    }
+
+    // Moves x in [0, 1] towards 1 for positive amounts and towards 0 for
+    // negative ones.
+    inline float Adjust(float x, float amount)
+    {
+        return amount >= 0.0f ? x + (1.0f - x) * amount : x + x * amount;
+    }
+
+    inline float HsvChannel(float n, float h, float s, float v)
+    {
+        float k = n + h;
+        if (k >= 6.0f)
+            k -= 6.0f;
+        float t = std::fmin(std::fmin(k, 4.0f - k), 1.0f);
+        return v - v * s * std::fmax(t, 0.0f);
+    }
+
+    inline uint8_t ToByte(float x)
+    {
+        return static_cast<uint8_t>(std::lrint(std::fmin(std::fmax(x, 0.0f), 255.0f)));
+    }
+
+    Color ShiftHsv(const Color &color, const HsvParams &params)
+    {
+        float r = color.r, g = color.g, b = color.b;
+        float mx = std::fmax(r, std::fmax(g, b));
+        float mn = std::fmin(r, std::fmin(g, b));
+        float d = mx - mn;
+        float inv = d > 0.0f ? 1.0f / d : 0.0f;
+
+        float h;
+        if (mx == r)
+            h = (g - b) * inv;
+        else if (mx == g)
+            h = (b - r) * inv + 2.0f;
+        else
+            h = (r - g) * inv + 4.0f;
+
+        h += params.hue;
+        if (h < 0.0f)
+            h += 6.0f;
+        if (h >= 6.0f)
+            h -= 6.0f;
+
+        float s = mx > 0.0f ? d / mx : 0.0f;
+        s = Adjust(s, params.saturation);
+        float v = Adjust(mx * (1.0f / 255.0f), params.value) * 255.0f;
+
+        return { ToByte(HsvChannel(5.0f, h, s, v)), ToByte(HsvChannel(3.0f, h, s, v)), ToByte(HsvChannel(1.0f, h, s, v)) };
+    }
+
+    void BuildLut(const Transform &transform, uint8_t *lut)
+    {
+        if (transform.type == Transform::Type::Gamma)
+        {
+            float exponent = 1.0f / transform.GetGamma();
+            for (int i = 0; i < 256; ++i)
+                lut[i] = ToByte(std::pow(i / 255.0f, exponent) * 255.0f);
+        }
+        else
+        {
+            float brightness = transform.a * 2.55f;
+            float contrast = std::pow(4.0f, transform.b / 100.0f);
+            for (int i = 0; i < 256; ++i)
+                lut[i] = ToByte((i - 127.5f) * contrast + 127.5f + brightness);
+        }
+    }
+
+#if defined(TRANSFORM_SSE2)
+    inline __m128 Select(__m128 mask, __m128 a, __m128 b)
+    {
+        return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+    }
+
+    inline __m128 Channel(__m128i x, int shift)
+    {
+        return _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(x, shift), _mm_set1_epi32(0xFF)));
+    }
+
+    inline __m128 AdjustWide(__m128 x, float amount)
+    {
+        __m128 target = amount >= 0.0f ? _mm_sub_ps(_mm_set1_ps(1.0f), x) : x;
+        return _mm_add_ps(x, _mm_mul_ps(target, _mm_set1_ps(amount)));
+    }
+
+    inline __m128 HsvChannelWide(float n, __m128 h, __m128 s, __m128 v)
+    {
+        __m128 six = _mm_set1_ps(6.0f);
+        __m128 k = _mm_add_ps(_mm_set1_ps(n), h);
+        k = Select(_mm_cmpge_ps(k, six), _mm_sub_ps(k, six), k);
+        __m128 t = _mm_min_ps(_mm_min_ps(k, _mm_sub_ps(_mm_set1_ps(4.0f), k)), _mm_set1_ps(1.0f));
+        t = _mm_max_ps(t, _mm_setzero_ps());
+        return _mm_sub_ps(v, _mm_mul_ps(_mm_mul_ps(v, s), t));
+    }
+
+    inline __m128i ToBytesWide(__m128 x)
+    {
+        x = _mm_min_ps(_mm_max_ps(x, _mm_setzero_ps()), _mm_set1_ps(255.0f));
+        return _mm_cvtps_epi32(x);
+    }
+
+    // Four colors per iteration, with every channel in its own register.
+    __m128i ShiftHsvWide(__m128i x, const HsvParams &params)
+    {
+        __m128 r = Channel(x, 0), g = Channel(x, 8), b = Channel(x, 16);
+        __m128 zero = _mm_setzero_ps(), six = _mm_set1_ps(6.0f);
+
+        __m128 mx = _mm_max_ps(r, _mm_max_ps(g, b));
+        __m128 mn = _mm_min_ps(r, _mm_min_ps(g, b));
+        __m128 d = _mm_sub_ps(mx, mn);
+        __m128 hasHue = _mm_cmpgt_ps(d, zero);
+        __m128 inv = _mm_and_ps(hasHue, _mm_div_ps(_mm_set1_ps(1.0f), Select(hasHue, d, _mm_set1_ps(1.0f))));
+
+        __m128 hr = _mm_mul_ps(_mm_sub_ps(g, b), inv);
+        __m128 hg = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(b, r), inv), _mm_set1_ps(2.0f));
+        __m128 hb = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(r, g), inv), _mm_set1_ps(4.0f));
+        __m128 h = Select(_mm_cmpeq_ps(mx, r), hr, Select(_mm_cmpeq_ps(mx, g), hg, hb));
+
+        h = _mm_add_ps(h, _mm_set1_ps(params.hue));
+        h = Select(_mm_cmplt_ps(h, zero), _mm_add_ps(h, six), h);
+        h = Select(_mm_cmpge_ps(h, six), _mm_sub_ps(h, six), h);
+
+        __m128 isLit = _mm_cmpgt_ps(mx, zero);
+        __m128 s = _mm_and_ps(isLit, _mm_div_ps(d, Select(isLit, mx, _mm_set1_ps(1.0f))));
+        s = AdjustWide(s, params.saturation);
+        __m128 v = _mm_mul_ps(AdjustWide(_mm_mul_ps(mx, _mm_set1_ps(1.0f / 255.0f)), params.value), _mm_set1_ps(255.0f));
+
+        __m128i ri = ToBytesWide(HsvChannelWide(5.0f, h, s, v));
+        __m128i gi = ToBytesWide(HsvChannelWide(3.0f, h, s, v));
+        __m128i bi = ToBytesWide(HsvChannelWide(1.0f, h, s, v));
+        return _mm_or_si128(ri, _mm_or_si128(_mm_slli_epi32(gi, 8), _mm_slli_epi32(bi, 16)));
+    }
+
+    // Rec. 601 luma in 8.8 fixed point; madd leaves 77r + 150g and 29b in
+    // the two halves of each 64-bit lane.
+    inline __m128i GrayPair(__m128i x)
+    {
+        const __m128i weights = _mm_setr_epi16(77, 150, 29, 0, 77, 150, 29, 0);
+        __m128i sums = _mm_madd_epi16(x, weights);
+        sums = _mm_add_epi32(sums, _mm_srli_epi64(sums, 32));
+        return _mm_srli_epi32(_mm_add_epi32(sums, _mm_set1_epi32(128)), 8);
+    }
+
+    __m128i GrayscaleWide(__m128i x)
+    {
+        __m128i zero = _mm_setzero_si128();
+        __m128i lo = _mm_shuffle_epi32(GrayPair(_mm_unpacklo_epi8(x, zero)), _MM_SHUFFLE(3, 3, 2, 0));
+        __m128i hi = _mm_shuffle_epi32(GrayPair(_mm_unpackhi_epi8(x, zero)), _MM_SHUFFLE(3, 3, 2, 0));
+        __m128i y = _mm_and_si128(_mm_unpacklo_epi64(lo, hi), _mm_set1_epi32(0xFF));
+        return _mm_or_si128(y, _mm_or_si128(_mm_slli_epi32(y, 8), _mm_slli_epi32(y, 16)));
+    }
+#endif
+
+    inline uint8_t Gray(const Color &color)
+    {
+        return static_cast<uint8_t>((77 * color.r + 150 * color.g + 29 * color.b + 128) >> 8);
+    }
+
+    void ApplyColors(const Transform &transform, std::span<Color> colors, const uint8_t *lut)
+    {
+        size_t i = 0;
+        Color *data = colors.data();
+
+        switch (transform.type)
+        {
+        case Transform::Type::HueSaturationValue:
+        {
+            auto params = GetHsvParams(transform);
+#if defined(TRANSFORM_SSE2)
+            for (; i + 4 <= colors.size(); i += 4)
+            {
+                __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(data + i), ShiftHsvWide(x, params));
+            }
+#endif
+            for (; i < colors.size(); ++i)
+                data[i] = ShiftHsv(data[i], params);
+            break;
+        }
+        case Transform::Type::Gamma:
+        case Transform::Type::BrightnessContrast:
+            // Both work on each channel alone, so a table does all the math.
+            for (; i < colors.size(); ++i)
+                data[i] = { lut[data[i].r], lut[data[i].g], lut[data[i].b] };
+            break;
+        case Transform::Type::Invert:
+#if defined(TRANSFORM_SSE2)
+            for (; i + 4 <= colors.size(); i += 4)
+            {
+                __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(data + i), _mm_xor_si128(x, _mm_set1_epi32(0xFFFFFF)));
+            }
+#endif
+            for (; i < colors.size(); ++i)
+                data[i] = { static_cast<uint8_t>(~data[i].r), static_cast<uint8_t>(~data[i].g), static_cast<uint8_t>(~data[i].b) };
+            break;
+        case Transform::Type::Grayscale:
+#if defined(TRANSFORM_SSE2)
+            for (; i + 4 <= colors.size(); i += 4)
+            {
+                __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(data + i), GrayscaleWide(x));
+            }
+#endif
+            for (; i < colors.size(); ++i)
+            {
+                uint8_t y = Gray(data[i]);
+                data[i] = { y, y, y };
+            }
+            break;
+        case Transform::Type::Snap15Bit:
+            bgr555::Snap(colors);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+Transform Transform::HueSaturationValue(int hueDegrees, int saturation, int value)
+{
+    int hue = static_cast<int>(std::lround(hueDegrees * 256.0 / 360.0));
+    return { Type::HueSaturationValue, static_cast<int8_t>(std::clamp(hue, -128, 127)),
+        static_cast<int8_t>(std::clamp(saturation, -100, 100)), static_cast<int8_t>(std::clamp(value, -100, 100)) };
+}
+
+Transform Transform::Gamma(float gamma)
+{
+    long a = std::lround(std::log10(std::max(gamma, 0.1f)) * 100.0f);
+    return { Type::Gamma, static_cast<int8_t>(std::clamp(a, -100L, 100L)) };
+}
+
+Transform Transform::BrightnessContrast(int brightness, int contrast)
+{
+    return { Type::BrightnessContrast, static_cast<int8_t>(std::clamp(brightness, -100, 100)), static_cast<int8_t>(std::clamp(contrast, -100, 100)) };
+}
+
+const char *Transform::GetTypeName(Type type)
+{
+    switch (type)
+    {
+    case Type::HueSaturationValue: return "Hue/Saturation/Value";
+    case Type::Gamma: return "Gamma";
+    case Type::BrightnessContrast: return "Brightness/Contrast";
+    case Type::Invert: return "Invert";
+    case Type::Grayscale: return "Grayscale";
+    case Type::Snap15Bit: return "Snap to 15-bit";
+    default: return "Unknown";
+    }
+}
+
+float Transform::GetGamma() const
+{
+    return std::pow(10.0f, a / 100.0f);
+}
+
+bool Transform::IsIdentity() const
+{
+    switch (type)
+    {
+    case Type::HueSaturationValue:
+    case Type::BrightnessContrast:
+        return a == 0 && b == 0 && c == 0;
+    case Type::Gamma:
+        return a == 0;
+    default:
+        return false;
+    }
+}
+
+void Transform::Apply(std::span<Color> colors) const
+{
+    uint8_t lut[256];
+    if (type == Type::Gamma || type == Type::BrightnessContrast)
+        BuildLut(*this, lut);
+    ApplyColors(*this, colors, lut);
+}
+
+void Transform::Apply(Palette &palette, size_t begin, size_t count) const
+{
+    if (count == 0)
+        return;
+
+    size_t firstChunk = begin / Palette::ChunkSize;
+    size_t lastChunk = (begin + count - 1) / Palette::ChunkSize;
+    size_t numJobs = (lastChunk - firstChunk) / ChunksPerJob + 1;
+
+    uint8_t lut[256];
+    if (type == Type::Gamma || type == Type::BrightnessContrast)
+        BuildLut(*this, lut);
+
+    auto applyChunks = [&](size_t job) {
+        size_t from = firstChunk + job * ChunksPerJob;
+        size_t to = std::min(from + ChunksPerJob, lastChunk + 1);
+        for (size_t i = from; i < to; ++i)
+        {
+            auto chunk = palette.GetChunk(i);
+            size_t chunkBegin = i * Palette::ChunkSize;
+            size_t first = std::max(begin, chunkBegin) - chunkBegin;
+            size_t last = std::min(begin + count, chunkBegin + chunk.size()) - chunkBegin;
+            ApplyColors(*this, chunk.subspan(first, last - first), lut);
+        }
+    };
+
+    if (numJobs == 1)
+        applyChunks(0);
+    else
+        JobSystem::Get().ParallelFor(numJobs, applyChunks);
+}
@@ -0,0 +1,102 @@
+#include "check.hpp"
+#include "palette.hpp"
+#include "codecs.hpp"
+
+#include <cstring>
+#include <filesystem>
+#include <string>
+
+namespace
+{
+    Color MakeColor(uint32_t v)
+    {
+        return { static_cast<uint8_t>(v), static_cast<uint8_t>(v >> 8), static_cast<uint8_t>(v >> 16) };
+    }
+
+    // Packing to 8-bit storage, reading back and the float view used by
+    // the color widgets all give back the same color.
+    void TestPackUnpack()
+    {
+        Palette palette(Palette::MaxColors);
+        for (uint32_t v = 0; v < Palette::MaxColors; ++v)
+            palette[v] = MakeColor(v);
+
+        const auto &colors = palette;
+        for (uint32_t v = 0; v < Palette::MaxColors; ++v)
+        {
+            Color color = colors[v];
+            CHECK(color == MakeColor(v));
+
+            uint32_t packed = color.r | (color.g << 8) | (color.b << 16);
+            CHECK(packed == v);
+
+            auto components = color.ToFloat();
+            CHECK(Color::FromFloat(components.data()) == color);
+        }
+    }
+
+    // Every color there is, through the JASC encoder and decoder.
+    void TestJascAllColors()
+    {
+        auto jasc = Codecs::FindByName("jasc");
+        CHECK(jasc != nullptr);
+
+        Palette palette(Palette::MaxColors);
+        for (uint32_t v = 0; v < Palette::MaxColors; ++v)
+            palette[v] = MakeColor(v);
+
+        std::string text, again;
+        palette.SaveToBuffer(text, jasc);
+
+        Palette loaded;
+        loaded.LoadFromBuffer(text, jasc);
+        CHECK(loaded == palette);
+
+        loaded.SaveToBuffer(again, jasc);
+        CHECK(again == text);
+    }
+
+    // A file on disk holding every component value in every channel comes
+    // back byte for byte.
+    void TestJascFile()
+    {
+        std::string text = "JASC-PAL\r\n0100\r\n256\r\n";
+        for (int i = 0; i < 256; ++i)
+            text += std::to_string(i) + " " + std::to_string((i * 7 + 3) & 255) + " " + std::to_string((i * 13 + 5) & 255) + "\r\n";
+
+        auto dir = std::filesystem::temp_directory_path();
+        auto in = (dir / "palette-roundtrip-in.pal").string();
+        auto out = (dir / "palette-roundtrip-out.pal").string();
+
+        std::FILE *file = std::fopen(in.c_str(), "wb");
+        CHECK(file != nullptr);
+        CHECK(std::fwrite(text.data(), 1, text.size(), file) == text.size());
+        std::fclose(file);
+
+        Palette palette;
+        palette.LoadFromFile(in);
+        CHECK(palette.size() == 256);
+        for (int i = 0; i < 256; ++i)
+            CHECK(palette[i] == MakeColor(i | ((i * 7 + 3) & 255) << 8 | ((i * 13 + 5) & 255) << 16));
+
+        CHECK(palette.SaveToFile(out, Codecs::FindByName("jasc")));
+
+        std::string saved(text.size() + 1, '\0');
+        file = std::fopen(out.c_str(), "rb");
+        CHECK(file != nullptr);
+        saved.resize(std::fread(saved.data(), 1, saved.size(), file));
+        std::fclose(file);
+        CHECK(saved == text);
+
+        std::filesystem::remove(in);
+        std::filesystem::remove(out);
+    }
+}
+
+int main()
+{
+    TestPackUnpack();
+    TestJascAllColors();
+    TestJascFile();
+    return 0;
+}
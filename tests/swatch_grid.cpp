@@ -0,0 +1,107 @@
+#include "check.hpp"
+#include "swatch_grid.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace
+{
+    Palette MakePalette(size_t size)
+    {
+        Palette palette(size);
+        for (size_t i = 0; i < size; ++i)
+            palette[i] = { static_cast<uint8_t>(i * 20 + 1), static_cast<uint8_t>(i + 1), static_cast<uint8_t>(200 - i) };
+        return palette;
+    }
+
+    // 10 colors in 4 columns of 4 px cells with a 1 px gap: every pixel is
+    // either its swatch's color or transparent.
+    void TestRasterize()
+    {
+        auto palette = MakePalette(10);
+        SwatchGrid grid(4, 4, 1);
+        CHECK(grid.GetWidth() == 16);
+        CHECK(grid.GetRowCount(palette.size()) == 3);
+
+        std::vector<uint8_t> rgba;
+        grid.Rasterize(palette, 0, 3, rgba);
+        CHECK(rgba.size() == 16 * 12 * 4);
+
+        for (int y = 0; y < 12; ++y)
+        {
+            for (int x = 0; x < 16; ++x)
+            {
+                const uint8_t *pixel = &rgba[(y * 16 + x) * 4];
+                size_t idx = (y / 4) * 4 + x / 4;
+                bool isGap = x % 4 == 3 || y % 4 == 3;
+
+                if (idx >= palette.size() || isGap)
+                {
+                    CHECK(pixel[0] == 0 && pixel[1] == 0 && pixel[2] == 0 && pixel[3] == 0);
+                }
+                else
+                {
+                    const auto &color = palette[idx];
+                    CHECK(pixel[0] == color.r && pixel[1] == color.g && pixel[2] == color.b && pixel[3] == 255);
+                }
+            }
+        }
+
+        // Only the requested rows.
+        grid.Rasterize(palette, 1, 1, rgba);
+        CHECK(rgba.size() == 16 * 4 * 4);
+        CHECK(rgba[0] == palette[4].r && rgba[3] == 255);
+    }
+
+    void TestHitTest()
+    {
+        SwatchGrid grid(4, 4, 1);
+        size_t numColors = 10;
+
+        for (int y = 0; y < 12; ++y)
+        {
+            for (int x = 0; x < 16; ++x)
+            {
+                size_t idx = (y / 4) * 4 + x / 4;
+                CHECK(grid.HitTest(x, y, numColors) == (idx < numColors ? idx : SIZE_MAX));
+            }
+        }
+
+        // The gap belongs to the swatch before it, the next pixel to the
+        // next swatch.
+        CHECK(grid.HitTest(2, 0, numColors) == 0);
+        CHECK(grid.HitTest(3, 0, numColors) == 0);
+        CHECK(grid.HitTest(4, 0, numColors) == 1);
+        CHECK(grid.HitTest(0, 3, numColors) == 0);
+        CHECK(grid.HitTest(0, 4, numColors) == 4);
+        CHECK(grid.HitTest(15, 7, numColors) == 7);
+
+        // Outside the grid and past the last color.
+        CHECK(grid.HitTest(-1, 0, numColors) == SIZE_MAX);
+        CHECK(grid.HitTest(0, -1, numColors) == SIZE_MAX);
+        CHECK(grid.HitTest(16, 0, numColors) == SIZE_MAX);
+        CHECK(grid.HitTest(8, 8, numColors) == SIZE_MAX);
+    }
+
+    // Cells too small for a gap are drawn without one.
+    void TestSmallCells()
+    {
+        SwatchGrid grid(4, 2, 1);
+        auto rect = grid.GetSwatchRect(5);
+        CHECK(rect.x0 == 2 && rect.y0 == 2 && rect.x1 == 4 && rect.y1 == 4);
+
+        std::vector<uint8_t> rgba;
+        auto palette = MakePalette(4);
+        grid.Rasterize(palette, 0, 1, rgba);
+        for (size_t i = 0; i < rgba.size(); i += 4)
+            CHECK(rgba[i + 3] == 255);
+    }
+}
+
+int main()
+{
+    TestRasterize();
+    TestHitTest();
+    TestSmallCells();
+    return 0;
+}